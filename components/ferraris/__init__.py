@@ -25,11 +25,18 @@ import esphome.codegen           as cg
 import esphome.config_validation as cv
 
 from esphome             import automation, pins
-from esphome.components  import number, sensor
+from esphome.core        import CORE
+from esphome.components  import number, sensor, time
 from esphome.cpp_helpers import gpio_pin_expression
 from esphome.const       import (
     CONF_ID,
-    CONF_VALUE
+    CONF_DURATION,
+    CONF_VALUE,
+    CONF_TIME_ID,
+    CONF_HOUR,
+    CONF_MINUTE,
+    CONF_SECOND,
+    CONF_UPDATE_INTERVAL
 )
 
 
@@ -39,11 +46,14 @@ MULTI_CONF = True
 # common
 CONF_FERRARIS_ID         = "ferraris_id"
 CONF_ROTATIONS_PER_KWH   = "rotations_per_kwh"
+CONF_MARKS_PER_ROTATION  = "marks_per_rotation"
 CONF_DEBOUNCE_THRESHOLD  = "debounce_threshold"
 CONF_ENERGY_START_VALUE  = "energy_start_value"
+CONF_ENERGY_START_VALUE_TIMEOUT = "energy_start_value_timeout"
 
 # digital input
 CONF_DIGITAL_INPUT       = "digital_input"
+CONF_POLLING_MODE        = "polling_mode"
 
 # analog input
 CONF_ANALOG_INPUT        = "analog_input"
@@ -54,12 +64,34 @@ CONF_CALIBRATE_ON_BOOT   = "calibrate_on_boot"
 CONF_NUM_CAPTURED_VALUES = "num_captured_values"
 CONF_MIN_LEVEL_DISTANCE  = "min_level_distance"
 CONF_MAX_ITERATIONS      = "max_iterations"
+CONF_PERSIST_CALIBRATION = "persist_calibration"
+CONF_SIGNAL_QUALITY_INTERVAL = "signal_quality_interval"
+CONF_PERIOD_DETECTION    = "period_detection"
+CONF_DECIMATION          = "decimation"
+CONF_WINDOW_SIZE         = "window_size"
+CONF_MAX_LAG             = "max_lag"
+CONF_MIN_CONFIDENCE      = "min_confidence"
+CONF_PUBLISH_INTERVAL    = "publish_interval"
+CONF_ENERGY_REGISTERS    = "energy_registers"
+CONF_TARIFFS             = "tariffs"
+CONF_TARIFF              = "tariff"
+CONF_SCHEDULE            = "schedule"
+CONF_AT                  = "at"
+CONF_CAPTURE_BUFFER_SIZE = "capture_buffer_size"
+
+MAX_TARIFFS = 8
+MAX_MARKS   = 16
 
 ferraris_ns = cg.esphome_ns.namespace("ferraris")
 FerrarisMeter = ferraris_ns.class_("FerrarisMeter", cg.Component)
+PollingMode = ferraris_ns.enum("PollingMode")
 SetEnergyMeterAction = ferraris_ns.class_("SetEnergyMeterAction", automation.Action)
 SetRotationCounterAction = ferraris_ns.class_("SetRotationCounterAction", automation.Action)
 StartAnalogCalibrationAction = ferraris_ns.class_("StartAnalogCalibrationAction", automation.Action)
+SetTariffAction = ferraris_ns.class_("SetTariffAction", automation.Action)
+LogEnergyRegistersAction = ferraris_ns.class_("LogEnergyRegistersAction", automation.Action)
+StartSampleCaptureAction = ferraris_ns.class_("StartSampleCaptureAction", automation.Action)
+DumpSampleCaptureAction = ferraris_ns.class_("DumpSampleCaptureAction", automation.Action)
 
 def ensure_gpio_or_adc(value):
     if CONF_DIGITAL_INPUT not in value and CONF_ANALOG_INPUT not in value:
@@ -68,25 +100,101 @@ def ensure_gpio_or_adc(value):
         raise cv.Invalid(f"Only one of '{CONF_DIGITAL_INPUT}' or '{CONF_ANALOG_INPUT}' can be specified, not both.")
     return value
 
+def ensure_analog_options(value):
+    if CONF_ANALOG_INPUT not in value:
+        for option in [CONF_PERIOD_DETECTION, CONF_PERSIST_CALIBRATION, CONF_SIGNAL_QUALITY_INTERVAL, CONF_CAPTURE_BUFFER_SIZE]:
+            if value.get(option, False):
+                raise cv.Invalid(f"'{option}' requires '{CONF_ANALOG_INPUT}' to be specified.")
+    return value
+
+def ensure_digital_options(value):
+    if CONF_DIGITAL_INPUT not in value and value[CONF_POLLING_MODE] != "normal":
+        raise cv.Invalid(f"'{CONF_POLLING_MODE}' requires '{CONF_DIGITAL_INPUT}' to be specified.")
+    return value
+
+def ensure_lag_within_window(value):
+    if value[CONF_MAX_LAG] > value[CONF_WINDOW_SIZE]:
+        raise cv.Invalid(f"'{CONF_MAX_LAG}' must not be greater than '{CONF_WINDOW_SIZE}'.")
+    return value
+
+def ensure_energy_start_value(value):
+    if CONF_ENERGY_START_VALUE_TIMEOUT in value and CONF_ENERGY_START_VALUE not in value:
+        raise cv.Invalid(f"'{CONF_ENERGY_START_VALUE_TIMEOUT}' requires '{CONF_ENERGY_START_VALUE}' to be specified.")
+    return value
+
+def ensure_tariff_schedule(value):
+    if CONF_SCHEDULE in value:
+        if CONF_TIME_ID not in value:
+            raise cv.Invalid(f"'{CONF_SCHEDULE}' requires '{CONF_TIME_ID}' to be specified.")
+        for entry in value[CONF_SCHEDULE]:
+            if entry[CONF_TARIFF] > value[CONF_TARIFFS]:
+                raise cv.Invalid(f"Scheduled tariff {entry[CONF_TARIFF]} exceeds the number of '{CONF_TARIFFS}'.")
+    return value
+
+POLLING_MODES = {
+    "normal": PollingMode.POLLING_MODE_NORMAL,
+    "high_frequency": PollingMode.POLLING_MODE_HIGH_FREQUENCY,
+    "adaptive": PollingMode.POLLING_MODE_ADAPTIVE
+}
+
 ANALOG_CALIBRATION_SCHEMA = cv.Schema({
         cv.Optional(CONF_NUM_CAPTURED_VALUES, default = 6000): cv.int_range(min=100, max=100000),
         cv.Optional(CONF_MIN_LEVEL_DISTANCE, default = 6.0): cv.positive_float,
         cv.Optional(CONF_MAX_ITERATIONS, default = 3): cv.int_range(min=1, max=10)})
 
+PERIOD_DETECTION_SCHEMA = cv.All(
+    cv.Schema({
+        cv.Optional(CONF_DECIMATION, default = 8): cv.int_range(min = 1, max = 100),
+        cv.Optional(CONF_WINDOW_SIZE, default = 256): cv.int_range(min = 16, max = 2048),
+        cv.Optional(CONF_MAX_LAG, default = 256): cv.int_range(min = 8, max = 2048),
+        cv.Optional(CONF_MIN_CONFIDENCE, default = "50%"): cv.percentage}),
+    ensure_lag_within_window)
+
+TARIFF_SCHEDULE_SCHEMA = cv.Schema({
+        cv.Required(CONF_AT): cv.time_of_day,
+        cv.Required(CONF_TARIFF): cv.int_range(min = 1, max = MAX_TARIFFS)})
+
+ENERGY_REGISTERS_SCHEMA = cv.All(
+    cv.Schema({
+        cv.Optional(CONF_TARIFFS, default = 1): cv.int_range(min = 1, max = MAX_TARIFFS),
+        cv.Optional(CONF_TIME_ID): cv.use_id(time.RealTimeClock),
+        cv.Optional(CONF_SCHEDULE): cv.ensure_list(TARIFF_SCHEDULE_SCHEMA)}),
+    ensure_tariff_schedule)
+
 CONFIG_SCHEMA = cv.All(
     cv.Schema({
         cv.GenerateID(): cv.declare_id(FerrarisMeter),
         cv.Optional(CONF_DIGITAL_INPUT): pins.internal_gpio_input_pin_schema,
+        cv.Optional(CONF_POLLING_MODE, default = "normal"): cv.enum(POLLING_MODES, lower = True),
         cv.Optional(CONF_ANALOG_INPUT): cv.use_id(sensor.Sensor),
         cv.Optional(CONF_ANALOG_THRESHOLD, default = 50): cv.Any(cv.Coerce(float), cv.use_id(number.Number)),
         cv.Optional(CONF_OFF_TOLERANCE, default = 0): cv.Any(cv.All(cv.positive_float, cv.Coerce(float)), cv.use_id(number.Number)),
         cv.Optional(CONF_ON_TOLERANCE, default = 0): cv.Any(cv.All(cv.positive_float, cv.Coerce(float)), cv.use_id(number.Number)),
         cv.Optional(CONF_ROTATIONS_PER_KWH, default = 75): cv.int_range(min = 1),
+        cv.Optional(CONF_MARKS_PER_ROTATION, default = 1): cv.int_range(min = 1, max = MAX_MARKS),
         cv.Optional(CONF_DEBOUNCE_THRESHOLD, default = 400): cv.Any(cv.int_range(min = 0), cv.use_id(number.Number)),
         cv.Optional(CONF_ENERGY_START_VALUE): cv.use_id(number.Number),
-        cv.Optional(CONF_CALIBRATE_ON_BOOT): ANALOG_CALIBRATION_SCHEMA
+        cv.Optional(CONF_ENERGY_START_VALUE_TIMEOUT): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_CALIBRATE_ON_BOOT): ANALOG_CALIBRATION_SCHEMA,
+        cv.Optional(CONF_PERSIST_CALIBRATION, default = False): cv.boolean,
+        cv.Optional(CONF_PERIOD_DETECTION): PERIOD_DETECTION_SCHEMA,
+        cv.Optional(CONF_SIGNAL_QUALITY_INTERVAL): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_CAPTURE_BUFFER_SIZE): cv.int_range(min = 100, max = 500000),
+        cv.Optional(CONF_PUBLISH_INTERVAL, default = "1s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_ENERGY_REGISTERS): ENERGY_REGISTERS_SCHEMA
     }).extend(cv.COMPONENT_SCHEMA),
-    ensure_gpio_or_adc)
+    ensure_gpio_or_adc,
+    ensure_digital_options,
+    ensure_analog_options,
+    ensure_energy_start_value)
+
+
+def get_sensor_update_interval(sensor_id):
+    for sensor_conf in CORE.config.get("sensor", []):
+        if (CONF_ID in sensor_conf) and (sensor_conf[CONF_ID].id == sensor_id.id):
+            return sensor_conf.get(CONF_UPDATE_INTERVAL)
+
+    return None
 
 
 async def to_code(config):
@@ -98,10 +206,15 @@ async def to_code(config):
     if CONF_DIGITAL_INPUT in config:
         pin = await gpio_pin_expression(config[CONF_DIGITAL_INPUT])
         cg.add(cmp.set_digital_input_pin(pin))
+        cg.add(cmp.set_polling_mode(config[CONF_POLLING_MODE]))
     elif CONF_ANALOG_INPUT in config:
         sens = await cg.get_variable(config[CONF_ANALOG_INPUT])
         cg.add(cmp.set_analog_input_sensor(sens))
 
+        update_interval = get_sensor_update_interval(config[CONF_ANALOG_INPUT])
+        if (update_interval is not None) and (update_interval.total_milliseconds < 0xFFFFFFFF):
+            cg.add(cmp.set_analog_input_interval(update_interval))
+
         if isinstance(config[CONF_ANALOG_THRESHOLD], float):
             cg.add(cmp.set_analog_input_threshold(config[CONF_ANALOG_THRESHOLD]))
         else:
@@ -127,16 +240,53 @@ async def to_code(config):
                             calib_conf[CONF_MIN_LEVEL_DISTANCE],
                             calib_conf[CONF_MAX_ITERATIONS]))
 
+        if config[CONF_PERSIST_CALIBRATION]:
+            cg.add(cmp.set_persist_calibration(config[CONF_ID].id))
+
+        if CONF_SIGNAL_QUALITY_INTERVAL in config:
+            cg.add(cmp.set_signal_quality_interval(config[CONF_SIGNAL_QUALITY_INTERVAL]))
+
+        if CONF_CAPTURE_BUFFER_SIZE in config:
+            cg.add(cmp.set_capture_buffer_size(config[CONF_CAPTURE_BUFFER_SIZE]))
+
+        if CONF_PERIOD_DETECTION in config:
+            period_conf = config[CONF_PERIOD_DETECTION]
+            cg.add(cmp.set_period_detection(
+                            period_conf[CONF_DECIMATION],
+                            period_conf[CONF_WINDOW_SIZE],
+                            period_conf[CONF_MAX_LAG],
+                            period_conf[CONF_MIN_CONFIDENCE]))
+
     if isinstance(config[CONF_DEBOUNCE_THRESHOLD], int):
         cg.add(cmp.set_debounce_threshold(config[CONF_DEBOUNCE_THRESHOLD]))
     else:
         num = await cg.get_variable(config[CONF_DEBOUNCE_THRESHOLD])
         cg.add(cmp.set_debounce_threshold_number(num))
 
+    cg.add(cmp.set_marks_per_rotation(config[CONF_MARKS_PER_ROTATION]))
+    cg.add(cmp.set_publish_interval(config[CONF_PUBLISH_INTERVAL]))
+
+    if CONF_ENERGY_REGISTERS in config:
+        registers_conf = config[CONF_ENERGY_REGISTERS]
+        cg.add(cmp.set_energy_registers(registers_conf[CONF_TARIFFS], config[CONF_ID].id))
+
+        if CONF_TIME_ID in registers_conf:
+            clock = await cg.get_variable(registers_conf[CONF_TIME_ID])
+            cg.add(cmp.set_time(clock))
+
+        for entry in registers_conf.get(CONF_SCHEDULE, []):
+            at = entry[CONF_AT]
+            cg.add(cmp.add_tariff_schedule_entry(
+                            at[CONF_HOUR] * 3600 + at[CONF_MINUTE] * 60 + at[CONF_SECOND],
+                            entry[CONF_TARIFF]))
+
     if CONF_ENERGY_START_VALUE in config:
         num = await cg.get_variable(config[CONF_ENERGY_START_VALUE])
         cg.add(cmp.set_energy_start_value_number(num))
 
+        if CONF_ENERGY_START_VALUE_TIMEOUT in config:
+            cg.add(cmp.set_energy_start_value_timeout(config[CONF_ENERGY_START_VALUE_TIMEOUT]))
+
 @automation.register_action(
     "ferraris.set_energy_meter",
     SetEnergyMeterAction,
@@ -189,3 +339,63 @@ async def start_analog_calibration_action_to_code(config, action_id, template_ar
                 config[CONF_MAX_ITERATIONS])
 
     return act
+
+@automation.register_action(
+    "ferraris.set_tariff",
+    SetTariffAction,
+    cv.Schema(
+    {
+        cv.Required(CONF_ID): cv.use_id(FerrarisMeter),
+        cv.Required(CONF_TARIFF): cv.templatable(cv.int_range(min = 1, max = MAX_TARIFFS))
+    }))
+async def set_tariff_action_to_code(config, action_id, template_arg, args):
+    parent = await cg.get_variable(config[CONF_ID])
+    act = cg.new_Pvariable(action_id, template_arg, parent)
+
+    tmpl = await cg.templatable(config[CONF_TARIFF], args, cg.uint8)
+    cg.add(act.set_tariff_value(tmpl))
+
+    return act
+
+@automation.register_action(
+    "ferraris.log_energy_registers",
+    LogEnergyRegistersAction,
+    cv.Schema(
+    {
+        cv.Required(CONF_ID): cv.use_id(FerrarisMeter)
+    }))
+async def log_energy_registers_action_to_code(config, action_id, template_arg, args):
+    parent = await cg.get_variable(config[CONF_ID])
+    act = cg.new_Pvariable(action_id, template_arg, parent)
+
+    return act
+
+@automation.register_action(
+    "ferraris.start_sample_capture",
+    StartSampleCaptureAction,
+    cv.Schema(
+    {
+        cv.Required(CONF_ID): cv.use_id(FerrarisMeter),
+        cv.Optional(CONF_DURATION, default = "0s"): cv.templatable(cv.positive_time_period_milliseconds)
+    }))
+async def start_sample_capture_action_to_code(config, action_id, template_arg, args):
+    parent = await cg.get_variable(config[CONF_ID])
+    act = cg.new_Pvariable(action_id, template_arg, parent)
+
+    tmpl = await cg.templatable(config[CONF_DURATION], args, cg.uint32)
+    cg.add(act.set_duration_value(tmpl))
+
+    return act
+
+@automation.register_action(
+    "ferraris.dump_sample_capture",
+    DumpSampleCaptureAction,
+    cv.Schema(
+    {
+        cv.Required(CONF_ID): cv.use_id(FerrarisMeter)
+    }))
+async def dump_sample_capture_action_to_code(config, action_id, template_arg, args):
+    parent = await cg.get_variable(config[CONF_ID])
+    act = cg.new_Pvariable(action_id, template_arg, parent)
+
+    return act
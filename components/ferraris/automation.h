@@ -79,6 +79,86 @@ namespace esphome::ferraris
         TemplatableValue<uint64_t, Ts...> m_rotation_counter_value;
     };
 
+    template<typename... Ts> class SetTariffAction : public Action<Ts...>
+    {
+    public:
+        SetTariffAction(FerrarisMeter *ferraris_meter)
+            : m_ferraris_meter(ferraris_meter)
+        {
+        }
+
+        void play(Ts... x) override
+        {
+            m_ferraris_meter->set_tariff(m_tariff_value.value(x...));
+        }
+
+        template<typename V> void set_tariff_value(V value)
+        {
+            m_tariff_value = value;
+        }
+
+    protected:
+        FerrarisMeter *m_ferraris_meter;
+        TemplatableValue<uint8_t, Ts...> m_tariff_value;
+    };
+
+    template<typename... Ts> class LogEnergyRegistersAction : public Action<Ts...>
+    {
+    public:
+        LogEnergyRegistersAction(FerrarisMeter *ferraris_meter)
+            : m_ferraris_meter(ferraris_meter)
+        {
+        }
+
+        void play(Ts... x) override
+        {
+            m_ferraris_meter->log_energy_registers();
+        }
+
+    protected:
+        FerrarisMeter *m_ferraris_meter;
+    };
+
+    template<typename... Ts> class StartSampleCaptureAction : public Action<Ts...>
+    {
+    public:
+        StartSampleCaptureAction(FerrarisMeter *ferraris_meter)
+            : m_ferraris_meter(ferraris_meter)
+        {
+        }
+
+        void play(Ts... x) override
+        {
+            m_ferraris_meter->start_sample_capture(m_duration_value.value(x...));
+        }
+
+        template<typename V> void set_duration_value(V value)
+        {
+            m_duration_value = value;
+        }
+
+    protected:
+        FerrarisMeter *m_ferraris_meter;
+        TemplatableValue<uint32_t, Ts...> m_duration_value;
+    };
+
+    template<typename... Ts> class DumpSampleCaptureAction : public Action<Ts...>
+    {
+    public:
+        DumpSampleCaptureAction(FerrarisMeter *ferraris_meter)
+            : m_ferraris_meter(ferraris_meter)
+        {
+        }
+
+        void play(Ts... x) override
+        {
+            m_ferraris_meter->dump_sample_capture();
+        }
+
+    protected:
+        FerrarisMeter *m_ferraris_meter;
+    };
+
     template<typename... Ts> class StartAnalogCalibrationAction : public Action<Ts...>
     {
     public:
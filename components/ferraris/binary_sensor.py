@@ -41,6 +41,7 @@ CODEOWNERS = ["@jensrossbach"]
 CONF_ROTATION_INDICATOR        = "rotation_indicator"
 CONF_ANALOG_CALIBRATION_STATE  = "analog_calibration_state"
 CONF_ANALOG_CALIBRATION_RESULT = "analog_calibration_result"
+CONF_CAPACITY_WARNING          = "capacity_warning"
 
 CONFIG_SCHEMA = cv.Schema(
 {
@@ -57,6 +58,11 @@ CONFIG_SCHEMA = cv.Schema(
     cv.Optional(CONF_ANALOG_CALIBRATION_RESULT): binary_sensor.binary_sensor_schema(
         device_class = DEVICE_CLASS_PROBLEM,
         entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+    ),
+    cv.Optional(CONF_CAPACITY_WARNING): binary_sensor.binary_sensor_schema(
+        icon="mdi:speedometer",
+        device_class = DEVICE_CLASS_PROBLEM,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC
     )
 })
 
@@ -75,3 +81,7 @@ async def to_code(config):
     if CONF_ANALOG_CALIBRATION_RESULT in config:
         sens = await binary_sensor.new_binary_sensor(config[CONF_ANALOG_CALIBRATION_RESULT])
         cg.add(cmp.set_analog_calibration_result_sensor(sens))
+
+    if CONF_CAPACITY_WARNING in config:
+        sens = await binary_sensor.new_binary_sensor(config[CONF_CAPACITY_WARNING])
+        cg.add(cmp.set_capacity_warning_sensor(sens))
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include "energy_registers.h"
+
+#include <algorithm>
+
+
+namespace esphome::ferraris
+{
+    EnergyRegisters::EnergyRegisters(uint8_t num_tariffs)
+        : m_num_tariffs(std::clamp<uint8_t>(num_tariffs, 1, MAX_TARIFFS))
+        , m_tariff(0)
+        , m_tariff_rotations{}
+        , m_hourly_rotations{}
+        , m_current_bucket(0)
+        , m_schedule()
+    {
+    }
+
+    void EnergyRegisters::set_tariff(uint8_t tariff)
+    {
+        m_tariff = std::min<uint8_t>(tariff, m_num_tariffs - 1);
+    }
+
+    void EnergyRegisters::advance_hours(uint32_t hours)
+    {
+        // hours beyond the size of the ring only clear buckets again
+        uint32_t steps = std::min<uint32_t>(hours, NUM_HOURLY_BUCKETS);
+
+        for (uint32_t i = 0; i < steps; ++i)
+        {
+            m_current_bucket = (m_current_bucket + 1) % NUM_HOURLY_BUCKETS;
+            m_hourly_rotations[m_current_bucket] = 0;
+        }
+    }
+
+    void EnergyRegisters::add_schedule_entry(uint32_t second_of_day, uint8_t tariff)
+    {
+        auto entry = std::make_pair(second_of_day, std::min<uint8_t>(tariff, m_num_tariffs - 1));
+
+        m_schedule.insert(std::upper_bound(m_schedule.begin(), m_schedule.end(), entry), entry);
+    }
+
+    int EnergyRegisters::get_scheduled_tariff(uint32_t second_of_day) const
+    {
+        if (m_schedule.empty())
+        {
+            return -1;
+        }
+
+        // the last entry of the previous day is still active before the first entry of the day
+        int tariff = m_schedule.back().second;
+
+        for (const auto &entry : m_schedule)
+        {
+            if (entry.first > second_of_day)
+            {
+                break;
+            }
+
+            tariff = entry.second;
+        }
+
+        return tariff;
+    }
+}  // namespace esphome::ferraris
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+namespace esphome::ferraris
+{
+    /*
+     * Incremental energy registers counting rotations per tariff and per hour
+     * in a fixed ring of hourly buckets. Counting a rotation is O(1); switching
+     * the tariff and advancing the hour are triggered from outside.
+     *
+     * Tariffs are addressed by their zero-based index here.
+     */
+    class EnergyRegisters
+    {
+    public:
+        static constexpr const uint8_t MAX_TARIFFS = 8;
+        static constexpr const uint8_t NUM_HOURLY_BUCKETS = 24;
+
+        explicit EnergyRegisters(uint8_t num_tariffs);
+
+        void add_rotation()
+        {
+            ++m_tariff_rotations[m_tariff];
+            ++m_hourly_rotations[m_current_bucket];
+        }
+
+        void set_tariff(uint8_t tariff);
+        void advance_hours(uint32_t hours);
+
+        // schedule entries map a time of day (in seconds) to a tariff
+        void add_schedule_entry(uint32_t second_of_day, uint8_t tariff);
+        // returns the tariff of the schedule entry active at the given time of day or -1 without schedule
+        int get_scheduled_tariff(uint32_t second_of_day) const;
+
+        uint8_t get_num_tariffs() const
+        {
+            return m_num_tariffs;
+        }
+
+        uint8_t get_tariff() const
+        {
+            return m_tariff;
+        }
+
+        uint64_t get_tariff_rotations(uint8_t tariff) const
+        {
+            return (tariff < m_num_tariffs) ? m_tariff_rotations[tariff] : 0;
+        }
+
+        void set_tariff_rotations(uint8_t tariff, uint64_t rotations)
+        {
+            if (tariff < m_num_tariffs)
+            {
+                m_tariff_rotations[tariff] = rotations;
+            }
+        }
+
+        // 0 is the current (incomplete) hour, 1 the previous hour and so on
+        uint32_t get_hourly_rotations(uint8_t hours_ago) const
+        {
+            if (hours_ago >= NUM_HOURLY_BUCKETS)
+            {
+                return 0;
+            }
+
+            return m_hourly_rotations[(m_current_bucket + NUM_HOURLY_BUCKETS - hours_ago) % NUM_HOURLY_BUCKETS];
+        }
+
+        bool has_schedule() const
+        {
+            return !m_schedule.empty();
+        }
+
+    private:
+        uint8_t m_num_tariffs;
+        uint8_t m_tariff;
+        std::array<uint64_t, MAX_TARIFFS> m_tariff_rotations;
+        std::array<uint32_t, NUM_HOURLY_BUCKETS> m_hourly_rotations;
+        uint8_t m_current_bucket;
+        std::vector<std::pair<uint32_t, uint8_t>> m_schedule;
+    };
+}  // namespace esphome::ferraris
@@ -26,7 +26,12 @@
 #include "ferraris_meter.h"
 #include "esphome/core/log.h"
 
+#include <algorithm>
+#include <cinttypes>
 #include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
 
 
 namespace esphome::ferraris
@@ -34,26 +39,99 @@ namespace esphome::ferraris
     static constexpr const uint32_t WATTS_PER_KW = 1000;
     static constexpr const uint32_t MS_PER_HOUR  = 60 * 60 * 1000;
     static constexpr const uint32_t KWH_TO_WMS   = WATTS_PER_KW * MS_PER_HOUR;
+    static constexpr const uint32_t SECONDS_PER_HOUR = 60 * 60;
 
     static constexpr const char *const TAG = "ferraris";
+    static constexpr const char *const ENERGY_START_VALUE_TIMEOUT  = "energy_start_value";
+    static constexpr const char *const SIGNAL_QUALITY_INTERVAL     = "signal_quality";
+    static constexpr const char *const PUBLISH_STATISTICS_INTERVAL = "publish_statistics";
+    static constexpr const char *const ENERGY_REGISTERS_INTERVAL   = "energy_registers";
+    static constexpr const char *const CAPTURE_DUMP_INTERVAL       = "capture_dump";
+    static constexpr const char *const CAPACITY_INTERVAL           = "capacity";
+
+    // interval for publishing the publish reduction diagnostics
+    static constexpr const uint32_t PUBLISH_STATISTICS_PERIOD = 60000;
+    // interval for checking the tariff schedule and the hourly rollover of the energy registers
+    static constexpr const uint32_t ENERGY_REGISTERS_PERIOD   = 10000;
+    // interval for publishing the detection capacity diagnostics
+    static constexpr const uint32_t CAPACITY_PERIOD           = 60000;
+
+    // the sample capture is dumped in small portions to avoid blocking the loop and flooding the logger
+    static constexpr const uint32_t CAPTURE_DUMP_PERIOD         = 20;
+    static constexpr const uint32_t CAPTURE_DUMP_LINES_PER_CALL = 2;
+    static constexpr const size_t   CAPTURE_DUMP_BYTES_PER_LINE = 48;
+
+    // prediction window around the next marker passage relative to the rotation time
+    static constexpr const float    ADAPTIVE_INITIAL_WINDOW_RATIO = 0.1f;
+    static constexpr const float    ADAPTIVE_MIN_WINDOW_RATIO     = 0.05f;
+    static constexpr const float    ADAPTIVE_MAX_WINDOW_RATIO     = 0.5f;
+    static constexpr const uint32_t ADAPTIVE_MIN_WINDOW_MARGIN    = 50;
+    // relaxed polling must still see the marker this many times during its passage
+    static constexpr const float    ADAPTIVE_SAFETY_FACTOR        = 4.0f;
+    // weight of a new measurement in the smoothed marker width and loop interval
+    static constexpr const float    ADAPTIVE_SMOOTHING            = 0.1f;
+    // default loop interval of ESPHome
+    static constexpr const float    DEFAULT_LOOP_INTERVAL         = 16.0f;
+
+    // marker width relative to the rotation time assumed until it has been measured
+    static constexpr const float CAPACITY_DEFAULT_MARKER_RATIO = 0.05f;
+    // both marker and gap must be seen by at least this many samples
+    static constexpr const float CAPACITY_MIN_SAMPLES          = 2.0f;
+    // resolution of the time stamps (millis)
+    static constexpr const float CAPACITY_MIN_SAMPLE_INTERVAL  = 1.0f;
+    // raise the capacity warning above this fraction of the maximum power and clear it below the second one
+    static constexpr const float CAPACITY_WARNING_RATIO        = 0.8f;
+    static constexpr const float CAPACITY_CLEAR_RATIO          = 0.7f;
+    // reference load for the timing resolution error reported at startup
+    static constexpr const float CAPACITY_REFERENCE_POWER      = 1000.0f;
+
+    // weight of a new analog value in the per-state level statistics
+    static constexpr const float LEVEL_STATISTICS_ALPHA = 0.01f;
+
+    // timestamps before 2020-01-01 indicate that the system time is not synchronized
+    static constexpr const time_t MIN_VALID_TIMESTAMP = 1577836800;
+
+    // maximum relative deviation of the rotation time from the estimated period
+    static constexpr const float ROTATION_TIME_TOLERANCE  = 0.25f;
+    // maximum deviation of the rotation count from the expected count per report
+    static constexpr const float ROTATION_COUNT_TOLERANCE = 1.5f;
 
     FerrarisMeter::FerrarisMeter(uint32_t rpkwh)
         : Component()
         , m_digital_input_pin(nullptr)
 #ifdef USE_SENSOR
         , m_analog_input_sensor(nullptr)
-        , m_power_consumption_sensor(nullptr)
-        , m_energy_meter_sensor(nullptr)
+        , m_power_consumption_channel()
+        , m_energy_meter_channel()
         , m_analog_value_spectrum_sensor(nullptr)
+        , m_rotation_period_estimate_sensor(nullptr)
+        , m_rotation_period_confidence_sensor(nullptr)
+        , m_rotation_count_deviation_sensor(nullptr)
+        , m_analog_level_separation_sensor(nullptr)
+        , m_analog_on_noise_sensor(nullptr)
+        , m_analog_off_noise_sensor(nullptr)
+        , m_analog_crossing_margin_sensor(nullptr)
+        , m_analog_hysteresis_margin_sensor(nullptr)
+        , m_analog_threshold_flaps_sensor(nullptr)
+        , m_publish_reduction_sensor(nullptr)
+        , m_tariff_energy_sensors{}
+        , m_active_tariff_sensor(nullptr)
+        , m_previous_hour_energy_sensor(nullptr)
+        , m_max_power_sensor(nullptr)
+        , m_timing_error_sensor(nullptr)
 #endif
 #ifdef USE_BINARY_SENSOR
         , m_rotation_indicator_sensor(nullptr)
         , m_analog_calibration_state_sensor(nullptr)
         , m_analog_calibration_result_sensor(nullptr)
+        , m_capacity_warning_sensor(nullptr)
 #endif
 #ifdef USE_SWITCH
         , m_calibration_mode_switch(nullptr)
 #endif
+#ifdef USE_TIME
+        , m_time(nullptr)
+#endif
 #ifdef USE_NUMBER
         , m_analog_input_threshold_number(nullptr)
         , m_off_tolerance_number(nullptr)
@@ -65,10 +143,13 @@ namespace esphome::ferraris
         , m_on_tolerance(0.0f)
         , m_rotations_per_kwh(rpkwh)
         , m_debounce_threshold(0)
+        , m_energy_start_value_timeout(0)
         , m_last_state(false)
         , m_last_time(-1)
         , m_last_rising_time(-1)
         , m_rotation_counter(0)
+        , m_mark_segments()
+        , m_last_power(0.0f)
         , m_off_level(0.0)
         , m_on_level(0.0)
         , m_num_captured_values(6000)
@@ -76,6 +157,44 @@ namespace esphome::ferraris
         , m_max_iterations(3)
         , m_iteration_counter(0)
         , m_level_value_counter(m_num_captured_values)
+        , m_calibration_data{}
+        , m_persist_calibration(false)
+        , m_validating_calibration(false)
+        , m_period_detector(nullptr)
+        , m_min_period_confidence(0.5f)
+        , m_period_report_time(-1)
+        , m_period_report_marks(0)
+        , m_signal_quality_interval(60000)
+        , m_crossing_margin(NAN)
+        , m_hysteresis_margin(NAN)
+        , m_threshold_flaps(0)
+        , m_above_threshold(false)
+        , m_threshold_excursion(false)
+        , m_publish_interval(1000)
+        , m_publish_statistics_updates(0)
+        , m_publish_statistics_publishes(0)
+        , m_energy_registers(nullptr)
+        , m_scheduled_tariff(-1)
+        , m_hour_key(-1)
+        , m_hour_start_time(0)
+        , m_sample_capture()
+        , m_capture_buffer_size(0)
+        , m_capture_events(0)
+        , m_capture_header{}
+        , m_capture_dump_offset(0)
+        , m_polling_mode(POLLING_MODE_NORMAL)
+        , m_high_frequency_loop()
+        , m_high_frequency_active(false)
+        , m_segment_time(0)
+        , m_marker_ratio(0.0f)
+        , m_window_ratio(ADAPTIVE_INITIAL_WINDOW_RATIO)
+        , m_marker_open(false)
+        , m_window_missed(false)
+        , m_loop_interval(DEFAULT_LOOP_INTERVAL)
+        , m_sample_interval(0.0f)
+        , m_analog_input_interval(0)
+        , m_last_sample_time(-1)
+        , m_capacity_warning(false)
         , m_calibration_mode(false)
         , m_start_value_received(false)
     {
@@ -90,6 +209,7 @@ namespace esphome::ferraris
         {
             m_analog_input_sensor->add_on_state_callback([this](float value)
             {
+                bool previous_state = m_last_state;
                 bool state = false;
 
                 if (m_last_state)
@@ -102,75 +222,98 @@ namespace esphome::ferraris
                 }
 
                 handle_state(state);
+                update_signal_quality(value, previous_state, state);
+                update_sample_interval(millis());
 
-                if (m_level_value_counter < m_num_captured_values)
+                if (m_sample_capture.is_active())
                 {
-                    if (m_level_value_counter == 0)
-                    {
-                        ++m_iteration_counter;
+                    capture_sample(value);
+                }
 
-                        ESP_LOGI(
-                            TAG, "Starting automatic analog calibration:  CAPT %u  DIST %.1f  ITER %u/%u",
-                            m_num_captured_values, m_min_level_distance, m_iteration_counter, m_max_iterations);
-                        set_analog_calibration_state(true);
+                if ((m_period_detector != nullptr) && m_period_detector->add_sample(value, millis()))
+                {
+                    report_period_estimate();
+                }
 
-                        // use current value as initial state
-                        m_on_level = value;
-                        m_off_level = value;
+                if (m_level_value_counter < m_num_captured_values)
+                {
+                    process_calibration_value(value);
+                }
+            });
 
-                        ESP_LOGI(TAG, "Calibrating initial levels:  VAL %.1f", value);
-                    }
-                    else
-                    {
-                        if (value > m_on_level)
-                        {
-                            m_on_level = value;
-                            ESP_LOGI(TAG, "Calibrating ON level:  VAL %.1f", m_on_level);
-                        }
+            if ((m_capture_buffer_size > 0) && !m_sample_capture.allocate(m_capture_buffer_size))
+            {
+                ESP_LOGE(TAG, "Failed to allocate sample capture buffer for %u records", m_capture_buffer_size);
+            }
 
-                        if (value < m_off_level)
-                        {
-                            m_off_level = value;
-                            ESP_LOGI(TAG, "Calibrating OFF level:  VAL %.1f", m_off_level);
-                        }
-                    }
+            if (has_signal_quality_sensors())
+            {
+                set_interval(SIGNAL_QUALITY_INTERVAL, m_signal_quality_interval, [this]()
+                {
+                    publish_signal_quality();
+                });
+            }
+        }
+#endif
 
-                    ++m_level_value_counter;
+#ifdef USE_SENSOR
+        if (m_power_consumption_channel.is_scheduled() || m_energy_meter_channel.is_scheduled())
+        {
+            PublishScheduler &scheduler = PublishScheduler::get_instance();
 
-                    if (m_level_value_counter == m_num_captured_values)
-                    {
-                        if ((m_on_level >= m_off_level) && ((m_on_level - m_off_level) >= m_min_level_distance))
-                        {
-                            float threshold = (m_off_level + m_on_level) / 2;
+            if (m_power_consumption_channel.is_scheduled())
+            {
+                scheduler.add_channel(&m_power_consumption_channel);
+            }
 
-                            if (m_analog_input_threshold_number != nullptr)
-                            {
-                                m_analog_input_threshold_number->publish_state(threshold);
-                            }
-                            else
-                            {
-                                m_analog_input_threshold = threshold;
-                            }
+            if (m_energy_meter_channel.is_scheduled())
+            {
+                scheduler.add_channel(&m_energy_meter_channel);
+            }
 
-                            ESP_LOGI(TAG, "Automatic analog calibration finished:  OFF %.1f  ON %.1f  TRSH %.1f", m_off_level, m_on_level, threshold);
-                            set_analog_calibration_state(false, m_on_level - m_off_level);
-                        }
-                        else if (m_iteration_counter < m_max_iterations)
-                        {
-                            ESP_LOGW(TAG, "Insufficient data for analog calibration, starting over");
-                            m_level_value_counter = 0;
-                        }
-                        else
-                        {
-                            ESP_LOGE(TAG, "Too many failed analog calibration iterations, giving up");
-                            set_analog_calibration_state(false, m_on_level - m_off_level, true);
-                        }
-                    }
-                }
+            // the first meter drives the tick for all meters of the node
+            scheduler.request_interval(m_publish_interval);
+            scheduler.claim_tick(this);
+        }
+
+        if (m_publish_reduction_sensor != nullptr)
+        {
+            set_interval(PUBLISH_STATISTICS_INTERVAL, PUBLISH_STATISTICS_PERIOD, [this]()
+            {
+                publish_publish_reduction();
             });
         }
 #endif
 
+        if (has_capacity_sensors())
+        {
+            set_interval(CAPACITY_INTERVAL, CAPACITY_PERIOD, [this]()
+            {
+                publish_capacity();
+            });
+        }
+
+        if ((m_digital_input_pin != nullptr) && (m_polling_mode == POLLING_MODE_HIGH_FREQUENCY))
+        {
+            m_high_frequency_loop.start();
+            m_high_frequency_active = true;
+        }
+
+        if (m_energy_registers != nullptr)
+        {
+            m_energy_registers_preference =
+                global_preferences->make_preference<EnergyRegistersData>(fnv1_hash("ferraris_energy_registers_" + m_energy_registers_key), true);
+            restore_energy_registers();
+
+            m_hour_start_time = millis();
+            update_energy_registers();
+
+            set_interval(ENERGY_REGISTERS_INTERVAL, ENERGY_REGISTERS_PERIOD, [this]()
+            {
+                update_energy_registers();
+            });
+        }
+
 #ifdef USE_BINARY_SENSOR
         if (m_rotation_indicator_sensor != nullptr)
         {
@@ -181,6 +324,11 @@ namespace esphome::ferraris
         {
             m_analog_calibration_state_sensor->publish_state(false);
         }
+
+        if (m_capacity_warning_sensor != nullptr)
+        {
+            m_capacity_warning_sensor->publish_state(false);
+        }
 #endif
 
 #ifdef USE_NUMBER
@@ -248,6 +396,21 @@ namespace esphome::ferraris
                 {
                     restore_energy_meter(value);
                 });
+
+                // rotations are counted right from the start, but the energy meter sensor
+                // is only published once the start value is known
+                if (m_energy_start_value_timeout > 0)
+                {
+                    set_timeout(ENERGY_START_VALUE_TIMEOUT, m_energy_start_value_timeout, [this]()
+                    {
+                        if (!m_start_value_received)
+                        {
+                            ESP_LOGW(
+                                TAG, "No energy start value received within %u ms, still waiting (%" PRIu64 " rotations counted since boot)",
+                                m_energy_start_value_timeout, m_rotation_counter);
+                        }
+                    });
+                }
             }
         }
         else
@@ -256,6 +419,23 @@ namespace esphome::ferraris
         }
 #endif
 
+#ifdef USE_SENSOR
+        if ((m_analog_input_sensor != nullptr) && m_persist_calibration)
+        {
+            m_calibration_preference =
+                global_preferences->make_preference<CalibrationData>(fnv1_hash("ferraris_calibration_" + m_calibration_key), true);
+
+            bool calibrate_on_boot = (m_level_value_counter == 0) && (m_iteration_counter == 0);
+
+            // reuse stored calibration at boot and only validate it against the live signal
+            // if a calibration at boot is configured, otherwise apply it as is
+            if (restore_calibration() && calibrate_on_boot)
+            {
+                m_validating_calibration = true;
+            }
+        }
+#endif
+
 #ifdef USE_SWITCH
         if (m_calibration_mode_switch != nullptr)
         {
@@ -280,14 +460,31 @@ namespace esphome::ferraris
     {
         if (m_digital_input_pin != nullptr)
         {
+            uint32_t now = millis();
+
             handle_state(m_digital_input_pin->digital_read());
+            update_sample_interval(now);
+
+            if (m_polling_mode == POLLING_MODE_ADAPTIVE)
+            {
+                update_adaptive_polling(now);
+            }
         }
+
+#ifdef USE_SENSOR
+        PublishScheduler::get_instance().loop(this, millis());
+#endif
     }
 
     void FerrarisMeter::dump_config()
     {
         ESP_LOGCONFIG(TAG, "Ferraris Meter");
         LOG_PIN("  Digital input pin: ", m_digital_input_pin);
+        if (m_digital_input_pin != nullptr)
+        {
+            static constexpr const char *const POLLING_MODES[] = {"normal", "high frequency", "adaptive"};
+            ESP_LOGCONFIG(TAG, "  Polling mode: %s", POLLING_MODES[m_polling_mode]);
+        }
 #ifdef USE_SENSOR
 #ifdef USE_NUMBER
         if ((m_analog_input_sensor != nullptr) && (m_analog_input_threshold_number == nullptr))
@@ -317,7 +514,61 @@ namespace esphome::ferraris
         }
 #endif
 #endif
+        if (m_period_detector != nullptr)
+        {
+            ESP_LOGCONFIG(
+                TAG, "  Period detection:  DEC %u  WIN %u  LAG %u  CONF %.0f %%",
+                m_period_detector->get_decimation(), m_period_detector->get_window_size(),
+                m_period_detector->get_max_lag(), m_min_period_confidence * 100);
+        }
+#ifdef USE_SENSOR
+        if ((m_analog_input_sensor != nullptr) && m_persist_calibration)
+        {
+            ESP_LOGCONFIG(TAG, "  Persistent analog calibration: enabled");
+        }
+        if ((m_analog_input_sensor != nullptr) && has_signal_quality_sensors())
+        {
+            ESP_LOGCONFIG(TAG, "  Signal quality interval: %u ms", m_signal_quality_interval);
+        }
+#endif
+        if (m_capture_buffer_size > 0)
+        {
+            ESP_LOGCONFIG(
+                TAG, "  Sample capture buffer: %u records (%s)",
+                m_capture_buffer_size, m_sample_capture.is_allocated() ? "allocated" : "allocation failed");
+        }
         ESP_LOGCONFIG(TAG, "  Rotations per kWh: %d", m_rotations_per_kwh);
+        if (m_mark_segments.get_num_marks() > 1)
+        {
+            ESP_LOGCONFIG(TAG, "  Marks per rotation: %u", m_mark_segments.get_num_marks());
+        }
+        if (get_sample_interval() > 0.0f)
+        {
+            ESP_LOGCONFIG(
+                TAG, "  Detection capacity:  SMPL %.1f ms  MARK %.1f %%  TMIN %.0f ms  PMAX %.0f W",
+                get_sample_interval(), ((m_marker_ratio > 0.0f) ? m_marker_ratio : CAPACITY_DEFAULT_MARKER_RATIO) * 100,
+                get_min_rotation_time(), get_max_power());
+
+            // average segment time at the reference load and shortest segment time at the maximum power
+            uint32_t reference_time = static_cast<uint32_t>(
+                                        KWH_TO_WMS / (CAPACITY_REFERENCE_POWER * m_rotations_per_kwh * m_mark_segments.get_num_marks()));
+            ESP_LOGCONFIG(
+                TAG, "  Timing resolution error:  %.2f %% at %.0f W, %.2f %% at maximum power",
+                get_timing_error(reference_time), CAPACITY_REFERENCE_POWER,
+                get_timing_error(static_cast<uint32_t>(get_min_rotation_time() * m_mark_segments.get_min_share())));
+        }
+        else
+        {
+            ESP_LOGCONFIG(
+                TAG, "  Detection capacity:  sample interval not yet measured  PMAX %.0f W (assuming %.0f ms)",
+                get_max_power(), CAPACITY_MIN_SAMPLE_INTERVAL);
+        }
+        if (m_energy_registers != nullptr)
+        {
+            ESP_LOGCONFIG(
+                TAG, "  Energy registers: %u tariffs, %s schedule",
+                m_energy_registers->get_num_tariffs(), m_energy_registers->has_schedule() ? "with" : "without");
+        }
 #ifdef USE_NUMBER
         if (m_debounce_threshold_number == nullptr)
         {
@@ -326,15 +577,46 @@ namespace esphome::ferraris
 #else
         ESP_LOGCONFIG(TAG, "  Static debounce threshold: %d ms", m_debounce_threshold);
 #endif
+#ifdef USE_NUMBER
+        if ((m_energy_start_value_number != nullptr) && (m_energy_start_value_timeout > 0))
+        {
+            ESP_LOGCONFIG(TAG, "  Energy start value timeout: %u ms", m_energy_start_value_timeout);
+        }
+#endif
 #ifdef USE_SENSOR
-        LOG_SENSOR("", "Power consumption sensor", m_power_consumption_sensor);
-        LOG_SENSOR("", "Energy meter sensor", m_energy_meter_sensor);
+        if (m_power_consumption_channel.is_scheduled() || m_energy_meter_channel.is_scheduled())
+        {
+            ESP_LOGCONFIG(TAG, "  Publish interval: %u ms", PublishScheduler::get_instance().get_interval());
+        }
+        m_power_consumption_channel.dump_config("Power consumption");
+        m_energy_meter_channel.dump_config("Energy meter");
+        LOG_SENSOR("", "Power consumption sensor", m_power_consumption_channel.get_sensor());
+        LOG_SENSOR("", "Energy meter sensor", m_energy_meter_channel.get_sensor());
         LOG_SENSOR("", "Analog value spectrum sensor", m_analog_value_spectrum_sensor);
+        LOG_SENSOR("", "Rotation period estimate sensor", m_rotation_period_estimate_sensor);
+        LOG_SENSOR("", "Rotation period confidence sensor", m_rotation_period_confidence_sensor);
+        LOG_SENSOR("", "Rotation count deviation sensor", m_rotation_count_deviation_sensor);
+        LOG_SENSOR("", "Analog level separation sensor", m_analog_level_separation_sensor);
+        LOG_SENSOR("", "Analog ON noise sensor", m_analog_on_noise_sensor);
+        LOG_SENSOR("", "Analog OFF noise sensor", m_analog_off_noise_sensor);
+        LOG_SENSOR("", "Analog crossing margin sensor", m_analog_crossing_margin_sensor);
+        LOG_SENSOR("", "Analog hysteresis margin sensor", m_analog_hysteresis_margin_sensor);
+        LOG_SENSOR("", "Analog threshold flaps sensor", m_analog_threshold_flaps_sensor);
+        LOG_SENSOR("", "Publish reduction sensor", m_publish_reduction_sensor);
+        for (sensor::Sensor *sens : m_tariff_energy_sensors)
+        {
+            LOG_SENSOR("", "Tariff energy sensor", sens);
+        }
+        LOG_SENSOR("", "Active tariff sensor", m_active_tariff_sensor);
+        LOG_SENSOR("", "Previous hour energy sensor", m_previous_hour_energy_sensor);
+        LOG_SENSOR("", "Maximum power sensor", m_max_power_sensor);
+        LOG_SENSOR("", "Timing error sensor", m_timing_error_sensor);
 #endif
 #ifdef USE_BINARY_SENSOR
         LOG_BINARY_SENSOR("", "Rotation indicator sensor", m_rotation_indicator_sensor);
         LOG_BINARY_SENSOR("", "Analog calibration state sensor", m_analog_calibration_state_sensor);
         LOG_BINARY_SENSOR("", "Analog calibration result sensor", m_analog_calibration_result_sensor);
+        LOG_BINARY_SENSOR("", "Capacity warning sensor", m_capacity_warning_sensor);
 #endif
 #ifdef USE_SWITCH
         LOG_SWITCH("", "Calibration mode switch", m_calibration_mode_switch);
@@ -365,6 +647,7 @@ namespace esphome::ferraris
                     if (m_last_rising_time < 0)
                     {
                         m_last_rising_time = now;
+                        m_marker_open = true;
                     }
                     else
                     {
@@ -373,23 +656,75 @@ namespace esphome::ferraris
                         if (falling_to_rising_duration < m_debounce_threshold)
                         {
                             ESP_LOGI(TAG, "Ignoring falling to rising duration below threshold:  %u ms", falling_to_rising_duration);
+                            m_threshold_flaps++;
+                            m_capture_events |= CAPTURE_FLAG_DEBOUNCED;
                         }
                         else
                         {
-                            uint32_t rotation_time = get_duration(m_last_rising_time, now);
+                            uint32_t segment_time = get_duration(m_last_rising_time, now);
+                            uint8_t segment = m_mark_segments.get_index();
+
+                            // full rotation time extrapolated from the learned share of the segment
+                            uint32_t rotation_time = static_cast<uint32_t>(
+                                                        std::round(m_mark_segments.get_rotation_time(segment, segment_time)));
+
+                            if (m_mark_segments.get_num_marks() > 1)
+                            {
+                                ESP_LOGI(
+                                    TAG, "Segment time:  %u ms (segment %u, rotation time %u ms)",
+                                    segment_time, segment + 1, rotation_time);
+                            }
+                            else
+                            {
+                                ESP_LOGI(TAG, "Rotation time:  %u ms", rotation_time);
+                            }
 
-                            ESP_LOGI(TAG, "Rotation time:  %u ms", rotation_time);
+                            m_period_report_marks++;
 
-                            m_rotation_counter++;
-                            ESP_LOGI(TAG, "Updated rotation counter:  %u rotations", m_rotation_counter);
+                            if (m_mark_segments.add_segment(segment_time))
+                            {
+                                m_rotation_counter++;
+                                ESP_LOGI(TAG, "Updated rotation counter:  %u rotations", m_rotation_counter);
+                                m_capture_events |= CAPTURE_FLAG_ROTATION;
+
+                                if (m_energy_registers != nullptr)
+                                {
+                                    // credit the rotation to the tariff and hour active right now
+                                    bool rollover = sync_energy_registers();
+                                    m_energy_registers->add_rotation();
+
+                                    // only updates the cache, ESPHome writes to flash at its flash_write_interval
+                                    store_energy_registers();
+
+                                    if (rollover)
+                                    {
+                                        publish_energy_registers(true);
+                                    }
+                                }
+
+                                check_rotation_time(m_mark_segments.get_last_rotation_time());
+                                update_energy_counter();
+                            }
 
                             update_power_consumption(rotation_time);
-                            update_energy_counter();
 
+                            if (m_polling_mode == POLLING_MODE_ADAPTIVE)
+                            {
+                                update_polling_prediction(segment_time);
+                            }
+
+                            // predicted duration of the next segment
+                            m_segment_time = static_cast<uint32_t>(
+                                                m_mark_segments.get_share(m_mark_segments.get_index()) * rotation_time);
                             m_last_rising_time = now;
+                            m_marker_open = true;
                         }
                     }
                 }
+                else
+                {
+                    update_marker_width(now);
+                }
 
                 m_last_time = now;
             }
@@ -406,12 +741,11 @@ namespace esphome::ferraris
         {
             m_last_time = -1;
             m_last_rising_time = -1;
+            m_last_power = 0.0f;
+            m_mark_segments.reset();
 
 #ifdef USE_SENSOR
-            if (m_power_consumption_sensor != nullptr)
-            {
-                m_power_consumption_sensor->publish_state(0.0);
-            }
+            m_power_consumption_channel.update(0.0f, millis(), true);
 #endif
         }
 
@@ -429,11 +763,17 @@ namespace esphome::ferraris
     {
         if (!m_start_value_received)
         {
-            m_rotation_counter = static_cast<uint64_t>(value / 1000 * m_rotations_per_kwh);
-            ESP_LOGI(TAG, "Restored rotation counter:  %u rotations", m_rotation_counter);
+            // merge rotations counted between boot and reception of the start value
+            uint64_t pre_restore_delta = m_rotation_counter;
+
+            m_rotation_counter = static_cast<uint64_t>(value / 1000 * m_rotations_per_kwh) + pre_restore_delta;
+            ESP_LOGI(
+                TAG, "Restored rotation counter:  %" PRIu64 " rotations (%" PRIu64 " counted before restore)",
+                m_rotation_counter, pre_restore_delta);
 
             m_start_value_received = true;
-            update_energy_counter();
+            cancel_timeout(ENERGY_START_VALUE_TIMEOUT);
+            update_energy_counter(true);
         }
     }
 
@@ -442,7 +782,10 @@ namespace esphome::ferraris
         m_rotation_counter = static_cast<uint64_t>(std::round(value * m_rotations_per_kwh));
         ESP_LOGI(TAG, "Set energy meter:  %.2f kWh (%u rotations)", value, m_rotation_counter);
 
-        update_energy_counter();
+        // an explicitly set value takes precedence over a start value received later
+        m_start_value_received = true;
+        cancel_timeout(ENERGY_START_VALUE_TIMEOUT);
+        update_energy_counter(true);
     }
 
     void FerrarisMeter::set_rotation_counter(uint64_t value)
@@ -450,32 +793,1048 @@ namespace esphome::ferraris
         m_rotation_counter = value;
         ESP_LOGI(TAG, "Set rotation counter:  %u rotations", m_rotation_counter);
 
-        update_energy_counter();
+        m_start_value_received = true;
+        cancel_timeout(ENERGY_START_VALUE_TIMEOUT);
+        update_energy_counter(true);
     }
 
-    void FerrarisMeter::update_power_consumption(uint32_t rotation_time)
+    float FerrarisMeter::get_power_estimate(uint32_t now) const
+    {
+        if (m_calibration_mode || (m_last_rising_time < 0))
+        {
+            return 0.0f;
+        }
+
+        uint32_t elapsed = get_duration(m_last_rising_time, now);
+
+        if (elapsed == 0)
+        {
+            return m_last_power;
+        }
+
+        // without a marker passage for longer than the last rotation time, power must be lower
+        float upper_bound = static_cast<float>(KWH_TO_WMS) * m_mark_segments.get_share(m_mark_segments.get_index())
+                                / (static_cast<float>(elapsed) * m_rotations_per_kwh);
+
+        return std::min(m_last_power, upper_bound);
+    }
+
+    float FerrarisMeter::get_energy() const
+    {
+        return static_cast<float>(m_rotation_counter) / m_rotations_per_kwh * WATTS_PER_KW;
+    }
+
+    bool FerrarisMeter::has_energy_baseline() const
+    {
+#ifdef USE_NUMBER
+        return (m_energy_start_value_number == nullptr) || m_start_value_received;
+#else
+        return true;
+#endif
+    }
+
+    void FerrarisMeter::set_tariff(uint8_t tariff)
     {
+        if (m_energy_registers == nullptr)
+        {
+            ESP_LOGW(TAG, "Cannot switch tariff, energy registers are not configured");
+            return;
+        }
+
+        if ((tariff < 1) || (tariff > m_energy_registers->get_num_tariffs()))
+        {
+            ESP_LOGW(TAG, "Ignoring invalid tariff %u (1-%u)", tariff, m_energy_registers->get_num_tariffs());
+            return;
+        }
+
+        m_energy_registers->set_tariff(tariff - 1);
+        ESP_LOGI(TAG, "Switched to tariff %u", tariff);
+
 #ifdef USE_SENSOR
-        if (m_power_consumption_sensor != nullptr)
+        if (m_active_tariff_sensor != nullptr)
         {
-            float pwr = static_cast<float>(KWH_TO_WMS) / (rotation_time * m_rotations_per_kwh);
+            m_active_tariff_sensor->publish_state(tariff);
+        }
+#endif
+    }
 
-            m_power_consumption_sensor->publish_state(pwr);
-            ESP_LOGI(TAG, "Published power consumption sensor state: %.2f W (%d Rotationtime)", pwr, rotation_time);
+    uint8_t FerrarisMeter::get_tariff() const
+    {
+        return (m_energy_registers != nullptr) ? m_energy_registers->get_tariff() + 1 : 0;
+    }
+
+    float FerrarisMeter::get_tariff_energy(uint8_t tariff) const
+    {
+        if ((m_energy_registers == nullptr) || (tariff < 1))
+        {
+            return NAN;
+        }
+
+        return static_cast<float>(m_energy_registers->get_tariff_rotations(tariff - 1)) / m_rotations_per_kwh * WATTS_PER_KW;
+    }
+
+    float FerrarisMeter::get_hourly_energy(uint8_t hours_ago) const
+    {
+        if (m_energy_registers == nullptr)
+        {
+            return NAN;
+        }
+
+        return static_cast<float>(m_energy_registers->get_hourly_rotations(hours_ago)) / m_rotations_per_kwh * WATTS_PER_KW;
+    }
+
+    void FerrarisMeter::log_energy_registers() const
+    {
+        if (m_energy_registers == nullptr)
+        {
+            ESP_LOGW(TAG, "Energy registers are not configured");
+            return;
+        }
+
+        ESP_LOGI(TAG, "Energy registers (active tariff %u):", get_tariff());
+
+        for (uint8_t tariff = 1; tariff <= m_energy_registers->get_num_tariffs(); ++tariff)
+        {
+            ESP_LOGI(TAG, "  Tariff %u:  %.2f Wh", tariff, get_tariff_energy(tariff));
+        }
+
+        for (uint8_t hours_ago = 0; hours_ago < EnergyRegisters::NUM_HOURLY_BUCKETS; ++hours_ago)
+        {
+            ESP_LOGI(TAG, "  Hour -%u:  %.2f Wh", hours_ago, get_hourly_energy(hours_ago));
+        }
+    }
+
+    void FerrarisMeter::update_energy_registers()
+    {
+        publish_energy_registers(sync_energy_registers());
+    }
+
+    bool FerrarisMeter::sync_energy_registers()
+    {
+        uint32_t now = millis();
+        uint32_t elapsed_hours = 0;
+        bool time_valid = false;
+
+#ifdef USE_TIME
+        if (m_time != nullptr)
+        {
+            ESPTime time = m_time->now();
+
+            if (time.is_valid())
+            {
+                time_valid = true;
+
+                // the schedule only switches at its boundaries, a tariff set by action persists until then
+                int tariff = m_energy_registers->get_scheduled_tariff(time.hour * SECONDS_PER_HOUR + time.minute * 60 + time.second);
+                if ((tariff >= 0) && (tariff != m_scheduled_tariff))
+                {
+                    m_scheduled_tariff = tariff;
+                    set_tariff(tariff + 1);
+                }
+
+                // buckets are aligned to the wall clock as soon as the time is valid
+                int64_t hour_key = static_cast<int64_t>(time.timestamp) / SECONDS_PER_HOUR;
+                if ((m_hour_key >= 0) && (hour_key > m_hour_key))
+                {
+                    elapsed_hours = static_cast<uint32_t>(std::min<int64_t>(hour_key - m_hour_key, EnergyRegisters::NUM_HOURLY_BUCKETS));
+                }
+
+                m_hour_key = hour_key;
+                m_hour_start_time = now;
+            }
         }
 #endif
+
+        if (!time_valid)
+        {
+            // without wall clock time, hours are counted from boot
+            m_hour_key = -1;
+
+            if (get_duration(m_hour_start_time, now) >= MS_PER_HOUR)
+            {
+                m_hour_start_time += MS_PER_HOUR;
+                elapsed_hours = 1;
+            }
+        }
+
+        if (elapsed_hours > 0)
+        {
+            m_energy_registers->advance_hours(elapsed_hours);
+            ESP_LOGD(TAG, "Energy of previous hour:  %.2f Wh", get_hourly_energy(1));
+        }
+
+        return elapsed_hours > 0;
     }
 
-    void FerrarisMeter::update_energy_counter()
+    void FerrarisMeter::publish_energy_registers(bool rollover)
     {
 #ifdef USE_SENSOR
-        if (m_energy_meter_sensor != nullptr)
+        for (uint8_t tariff = 1; tariff <= m_energy_registers->get_num_tariffs(); ++tariff)
         {
-            float energy = static_cast<float>(m_rotation_counter) / m_rotations_per_kwh * WATTS_PER_KW;
+            sensor::Sensor *sens = m_tariff_energy_sensors[tariff - 1];
+            float energy = get_tariff_energy(tariff);
 
-            m_energy_meter_sensor->publish_state(energy);
-            ESP_LOGI(TAG, "Published energy meter sensor state: %.2f Wh (%d rotations)", energy, m_rotation_counter);
+            // only publish registers which have changed since the last check
+            if ((sens != nullptr) && (!sens->has_state() || (sens->get_raw_state() != energy)))
+            {
+                sens->publish_state(energy);
+            }
         }
+
+        if ((m_active_tariff_sensor != nullptr) && !m_active_tariff_sensor->has_state())
+        {
+            m_active_tariff_sensor->publish_state(get_tariff());
+        }
+
+        if ((m_previous_hour_energy_sensor != nullptr) && rollover)
+        {
+            m_previous_hour_energy_sensor->publish_state(get_hourly_energy(1));
+        }
+#endif
+    }
+
+    void FerrarisMeter::store_energy_registers()
+    {
+        EnergyRegistersData data{};
+
+        data.num_tariffs = m_energy_registers->get_num_tariffs();
+        for (uint8_t tariff = 0; tariff < data.num_tariffs; ++tariff)
+        {
+            data.tariff_rotations[tariff] = m_energy_registers->get_tariff_rotations(tariff);
+        }
+
+        data.checksum = calculate_checksum(data);
+
+        if (!m_energy_registers_preference.save(&data))
+        {
+            ESP_LOGW(TAG, "Failed to store energy registers");
+        }
+    }
+
+    void FerrarisMeter::restore_energy_registers()
+    {
+        EnergyRegistersData data{};
+
+        if (!m_energy_registers_preference.load(&data))
+        {
+            ESP_LOGI(TAG, "No stored energy registers found");
+            return;
+        }
+
+        if ((data.checksum != calculate_checksum(data)) || (data.num_tariffs != m_energy_registers->get_num_tariffs()))
+        {
+            ESP_LOGW(TAG, "Stored energy registers are invalid or do not match the number of tariffs");
+            return;
+        }
+
+        for (uint8_t tariff = 0; tariff < data.num_tariffs; ++tariff)
+        {
+            m_energy_registers->set_tariff_rotations(tariff, data.tariff_rotations[tariff]);
+        }
+
+        ESP_LOGI(TAG, "Restored energy registers of %u tariffs", data.num_tariffs);
+    }
+
+    void FerrarisMeter::start_sample_capture(uint32_t duration)
+    {
+        if (!m_sample_capture.is_allocated())
+        {
+            ESP_LOGW(TAG, "Cannot start sample capture, no capture buffer available");
+            return;
+        }
+
+        cancel_interval(CAPTURE_DUMP_INTERVAL);
+
+        m_capture_events = 0;
+        m_sample_capture.start(duration, millis());
+
+        ESP_LOGI(
+            TAG, "Started sample capture:  CAP %u  DUR %u ms",
+            m_sample_capture.get_capacity(), duration);
+    }
+
+    void FerrarisMeter::capture_sample(float value)
+    {
+        uint8_t flags = m_capture_events;
+        m_capture_events = 0;
+
+        if (m_last_state)
+        {
+            flags |= CAPTURE_FLAG_STATE;
+        }
+
+        if (m_calibration_mode)
+        {
+            flags |= CAPTURE_FLAG_CALIBRATION;
+        }
+
+        if (!m_sample_capture.add(value, flags, millis()))
+        {
+            ESP_LOGI(TAG, "Finished sample capture:  %u records", m_sample_capture.get_count());
+        }
+    }
+
+    void FerrarisMeter::dump_sample_capture()
+    {
+        if (!m_sample_capture.is_allocated())
+        {
+            ESP_LOGW(TAG, "Cannot dump sample capture, no capture buffer available");
+            return;
+        }
+
+        if (m_sample_capture.is_active())
+        {
+            m_sample_capture.stop();
+            ESP_LOGI(TAG, "Stopped sample capture:  %u records", m_sample_capture.get_count());
+        }
+
+        m_capture_header = CaptureHeader{};
+        std::memcpy(m_capture_header.magic, "FRCP", sizeof(m_capture_header.magic));
+        m_capture_header.version = CAPTURE_FORMAT_VERSION;
+        m_capture_header.count = m_sample_capture.get_count();
+        m_capture_header.start_time = m_sample_capture.get_start_time();
+        m_capture_header.threshold = m_analog_input_threshold;
+        m_capture_header.off_tolerance = m_off_tolerance;
+        m_capture_header.on_tolerance = m_on_tolerance;
+        m_capture_header.debounce_threshold = m_debounce_threshold;
+        m_capture_header.rotations_per_kwh = m_rotations_per_kwh;
+        m_capture_header.marks_per_rotation = m_mark_segments.get_num_marks();
+
+        m_capture_dump_offset = 0;
+
+        // the lines are prefixed with the magic so that a host tool can extract them from the log
+        ESP_LOGI(TAG, "FRCP BEGIN %u", m_sample_capture.get_serialized_size());
+
+        set_interval(CAPTURE_DUMP_INTERVAL, CAPTURE_DUMP_PERIOD, [this]()
+        {
+            dump_capture_chunk();
+        });
+    }
+
+    void FerrarisMeter::dump_capture_chunk()
+    {
+        uint8_t buffer[CAPTURE_DUMP_BYTES_PER_LINE];
+
+        for (uint32_t line = 0; line < CAPTURE_DUMP_LINES_PER_CALL; ++line)
+        {
+            size_t num_bytes = m_sample_capture.read(m_capture_header, m_capture_dump_offset, buffer, sizeof(buffer));
+
+            if (num_bytes == 0)
+            {
+                ESP_LOGI(TAG, "FRCP END");
+                cancel_interval(CAPTURE_DUMP_INTERVAL);
+                return;
+            }
+
+            ESP_LOGI(TAG, "FRCP %u %s", m_capture_dump_offset, base64_encode(buffer, num_bytes).c_str());
+            m_capture_dump_offset += num_bytes;
+        }
+    }
+
+    void FerrarisMeter::update_adaptive_polling(uint32_t now)
+    {
+        bool high_frequency = needs_high_frequency_polling(now);
+        if (high_frequency != m_high_frequency_active)
+        {
+            if (high_frequency)
+            {
+                m_high_frequency_loop.start();
+            }
+            else
+            {
+                m_high_frequency_loop.stop();
+            }
+
+            m_high_frequency_active = high_frequency;
+            ESP_LOGV(TAG, "%s high frequency polling", high_frequency ? "Starting" : "Stopping");
+        }
+    }
+
+    bool FerrarisMeter::needs_high_frequency_polling(uint32_t now)
+    {
+        if (m_calibration_mode)
+        {
+            return false;
+        }
+
+        // learn rotation time and marker width first
+        if ((m_last_rising_time < 0) || (m_segment_time == 0) || (m_marker_ratio <= 0.0f))
+        {
+            return true;
+        }
+
+        // keep polling fast during short marker passages to measure their end precisely
+        if (m_marker_open)
+        {
+            return m_marker_ratio * m_segment_time < ADAPTIVE_SAFETY_FACTOR * m_loop_interval;
+        }
+
+        uint32_t elapsed = get_duration(m_last_rising_time, now);
+        uint32_t margin = std::max(
+                                ADAPTIVE_MIN_WINDOW_MARGIN,
+                                static_cast<uint32_t>(m_window_ratio * m_segment_time));
+
+        if (elapsed + margin < m_segment_time)
+        {
+            return false;
+        }
+
+        // within the prediction window, fast polling is only needed if the marker is too short for the regular loop
+        if (elapsed <= m_segment_time + margin)
+        {
+            return m_marker_ratio * m_segment_time < ADAPTIVE_SAFETY_FACTOR * m_loop_interval;
+        }
+
+        if (!m_window_missed)
+        {
+            // no marker within the predicted window, widen it for the next rotations
+            m_window_missed = true;
+            m_window_ratio = std::min(m_window_ratio * 2, ADAPTIVE_MAX_WINDOW_RATIO);
+            ESP_LOGD(TAG, "Missed predicted marker passage, widening window to %.0f %%", m_window_ratio * 100);
+        }
+
+        // the disc is slower than predicted, relax as soon as the marker would be long enough to be seen anyway
+        return m_marker_ratio * elapsed < ADAPTIVE_SAFETY_FACTOR * m_loop_interval;
+    }
+
+    void FerrarisMeter::update_polling_prediction(uint32_t segment_time)
+    {
+        if (m_segment_time > 0)
+        {
+            uint32_t margin = std::max(
+                                    ADAPTIVE_MIN_WINDOW_MARGIN,
+                                    static_cast<uint32_t>(m_window_ratio * m_segment_time));
+            uint32_t deviation = (segment_time > m_segment_time)
+                                    ? segment_time - m_segment_time
+                                    : m_segment_time - segment_time;
+
+            if (deviation > margin)
+            {
+                // marker passage outside of the predicted window (e.g. earlier due to load change)
+                if (!m_window_missed)
+                {
+                    m_window_ratio = std::min(m_window_ratio * 2, ADAPTIVE_MAX_WINDOW_RATIO);
+                    ESP_LOGD(TAG, "Marker passage outside of predicted window, widening window to %.0f %%", m_window_ratio * 100);
+                }
+            }
+            else if (!m_window_missed)
+            {
+                // shrink the window slowly while predictions succeed
+                m_window_ratio = std::max(m_window_ratio * 0.9f, ADAPTIVE_MIN_WINDOW_RATIO);
+            }
+        }
+
+        m_window_missed = false;
+    }
+
+    void FerrarisMeter::update_marker_width(uint32_t now)
+    {
+        if (m_marker_open && (m_segment_time > 0))
+        {
+            float ratio = static_cast<float>(get_duration(m_last_rising_time, now)) / m_segment_time;
+            m_marker_ratio = (m_marker_ratio > 0.0f)
+                                ? m_marker_ratio + ADAPTIVE_SMOOTHING * (ratio - m_marker_ratio)
+                                : ratio;
+        }
+
+        m_marker_open = false;
+    }
+
+    void FerrarisMeter::update_sample_interval(uint32_t now)
+    {
+        if (m_last_sample_time >= 0)
+        {
+            float interval = static_cast<float>(get_duration(static_cast<uint32_t>(m_last_sample_time), now));
+
+            // the regular loop interval is only representative while nobody requests high frequency looping
+            if ((m_digital_input_pin != nullptr) && !m_high_frequency_loop.is_high_frequency())
+            {
+                m_loop_interval += ADAPTIVE_SMOOTHING * (interval - m_loop_interval);
+            }
+
+            // in adaptive mode, the marker is only sampled within the prediction window
+            if ((m_polling_mode != POLLING_MODE_ADAPTIVE) || m_high_frequency_active)
+            {
+                m_sample_interval = (m_sample_interval > 0.0f)
+                                        ? m_sample_interval + ADAPTIVE_SMOOTHING * (interval - m_sample_interval)
+                                        : interval;
+            }
+        }
+
+        m_last_sample_time = now;
+    }
+
+    float FerrarisMeter::get_sample_interval() const
+    {
+        if (m_sample_interval > 0.0f)
+        {
+            return m_sample_interval;
+        }
+
+        // the regular loop interval is the best guess for the digital input until it has been measured
+        if ((m_digital_input_pin != nullptr) && (m_polling_mode == POLLING_MODE_NORMAL))
+        {
+            return DEFAULT_LOOP_INTERVAL;
+        }
+
+#ifdef USE_SENSOR
+        // the configured update interval of the analog sensor is the best guess until it has been measured
+        if (m_analog_input_sensor != nullptr)
+        {
+            return static_cast<float>(m_analog_input_interval);
+        }
+#endif
+
+        return 0.0f;
+    }
+
+    float FerrarisMeter::get_min_rotation_time() const
+    {
+        float marker_ratio = (m_marker_ratio > 0.0f)
+                                ? std::min(m_marker_ratio, 1.0f - CAPACITY_DEFAULT_MARKER_RATIO)
+                                : CAPACITY_DEFAULT_MARKER_RATIO;
+        float sample_interval = std::max(get_sample_interval(), CAPACITY_MIN_SAMPLE_INTERVAL);
+
+        // the gap after the marker must outlast the debounce threshold and both marker and gap must be sampled
+        float min_time = m_debounce_threshold / (1.0f - marker_ratio);
+        min_time = std::max(min_time, CAPACITY_MIN_SAMPLES * sample_interval / marker_ratio);
+        min_time = std::max(min_time, CAPACITY_MIN_SAMPLES * sample_interval / (1.0f - marker_ratio));
+
+        // the above applies to the shortest segment between two marks
+        return min_time / m_mark_segments.get_min_share();
+    }
+
+    float FerrarisMeter::get_max_power() const
+    {
+        return static_cast<float>(KWH_TO_WMS) / (get_min_rotation_time() * m_rotations_per_kwh);
+    }
+
+    float FerrarisMeter::get_timing_error(uint32_t segment_time) const
+    {
+        if (segment_time == 0)
+        {
+            return NAN;
+        }
+
+        // each edge is detected up to one sample interval late, so the segment time is off by up to one interval
+        return 100.0f * std::max(get_sample_interval(), CAPACITY_MIN_SAMPLE_INTERVAL) / segment_time;
+    }
+
+    void FerrarisMeter::check_capacity(float power)
+    {
+        float max_power = get_max_power();
+        bool warning = power > (m_capacity_warning ? CAPACITY_CLEAR_RATIO : CAPACITY_WARNING_RATIO) * max_power;
+
+        if (warning != m_capacity_warning)
+        {
+            m_capacity_warning = warning;
+
+            if (warning)
+            {
+                ESP_LOGW(TAG, "Power consumption of %.0f W approaches the detection capacity of %.0f W", power, max_power);
+            }
+            else
+            {
+                ESP_LOGI(TAG, "Power consumption of %.0f W back within the detection capacity of %.0f W", power, max_power);
+            }
+
+#ifdef USE_BINARY_SENSOR
+            if (m_capacity_warning_sensor != nullptr)
+            {
+                m_capacity_warning_sensor->publish_state(warning);
+            }
+#endif
+        }
+    }
+
+    void FerrarisMeter::publish_capacity()
+    {
+        // re-evaluate the warning also when rotations stopped
+        float power = get_power_estimate(millis());
+        check_capacity(power);
+
+        float max_power = get_max_power();
+        float timing_error = (power > 0.0f) ? get_timing_error(m_segment_time) : NAN;
+
+        ESP_LOGD(
+            TAG, "Detection capacity:  SMPL %.1f ms  PMAX %.0f W  ERR %.2f %%",
+            get_sample_interval(), max_power, timing_error);
+
+#ifdef USE_SENSOR
+        if (m_max_power_sensor != nullptr)
+        {
+            m_max_power_sensor->publish_state(max_power);
+        }
+
+        if (m_timing_error_sensor != nullptr)
+        {
+            m_timing_error_sensor->publish_state(timing_error);
+        }
+#endif
+    }
+
+    bool FerrarisMeter::has_capacity_sensors() const
+    {
+        bool ret = false;
+
+#ifdef USE_SENSOR
+        ret = ret || (m_max_power_sensor != nullptr) || (m_timing_error_sensor != nullptr);
+#endif
+#ifdef USE_BINARY_SENSOR
+        ret = ret || (m_capacity_warning_sensor != nullptr);
+#endif
+
+        return ret;
+    }
+
+    void FerrarisMeter::update_power_consumption(uint32_t rotation_time)
+    {
+        float pwr = static_cast<float>(KWH_TO_WMS) / (rotation_time * m_rotations_per_kwh);
+        m_last_power = pwr;
+
+        check_capacity(pwr);
+
+#ifdef USE_SENSOR
+        if (m_power_consumption_channel.update(pwr, millis()))
+        {
+            ESP_LOGI(TAG, "Published power consumption sensor state: %.2f W (%d Rotationtime)", pwr, rotation_time);
+        }
+#endif
+    }
+
+    void FerrarisMeter::update_energy_counter(bool immediate)
+    {
+#ifdef USE_SENSOR
+#ifdef USE_NUMBER
+        if ((m_energy_start_value_number != nullptr) && !m_start_value_received)
+        {
+            // avoid publishing a meter reading which is not yet based on the start value
+            ESP_LOGD(TAG, "Deferring energy meter sensor state until start value is received (%" PRIu64 " rotations)", m_rotation_counter);
+            return;
+        }
+#endif
+
+        float energy = get_energy();
+
+        if (m_energy_meter_channel.update(energy, millis(), immediate))
+        {
+            ESP_LOGI(TAG, "Published energy meter sensor state: %.2f Wh (%d rotations)", energy, m_rotation_counter);
+        }
+#endif
+    }
+
+    void FerrarisMeter::publish_publish_reduction()
+    {
+#ifdef USE_SENSOR
+        uint32_t updates = m_power_consumption_channel.get_num_updates() + m_energy_meter_channel.get_num_updates();
+        uint32_t publishes = m_power_consumption_channel.get_num_publishes() + m_energy_meter_channel.get_num_publishes();
+
+        uint32_t period_updates = updates - m_publish_statistics_updates;
+        uint32_t period_publishes = publishes - m_publish_statistics_publishes;
+
+        m_publish_statistics_updates = updates;
+        m_publish_statistics_publishes = publishes;
+
+        // heartbeat publishes may exceed the number of updates while the meter is idle
+        float reduction = ((period_updates > 0) && (period_publishes < period_updates))
+                            ? 100.0f * (period_updates - period_publishes) / period_updates
+                            : 0.0f;
+
+        ESP_LOGD(
+            TAG, "Publish statistics:  %u updates, %u publishes (%.1f %% reduction)",
+            period_updates, period_publishes, reduction);
+
+        if (m_publish_reduction_sensor != nullptr)
+        {
+            m_publish_reduction_sensor->publish_state(reduction);
+        }
+#endif
+    }
+
+    void FerrarisMeter::process_calibration_value(float value)
+    {
+        if (m_level_value_counter == 0)
+        {
+            if (m_validating_calibration)
+            {
+                ESP_LOGI(
+                    TAG, "Validating stored analog calibration:  CAPT %u  OFF %.1f  ON %.1f  TRSH %.1f",
+                    m_num_captured_values, m_calibration_data.off_level, m_calibration_data.on_level, m_calibration_data.threshold);
+            }
+            else
+            {
+                ++m_iteration_counter;
+
+                ESP_LOGI(
+                    TAG, "Starting automatic analog calibration:  CAPT %u  DIST %.1f  ITER %u/%u",
+                    m_num_captured_values, m_min_level_distance, m_iteration_counter, m_max_iterations);
+                set_analog_calibration_state(true);
+
+                ESP_LOGI(TAG, "Calibrating initial levels:  VAL %.1f", value);
+            }
+
+            // use current value as initial state
+            m_on_level = value;
+            m_off_level = value;
+        }
+        else
+        {
+            if (value > m_on_level)
+            {
+                m_on_level = value;
+
+                if (!m_validating_calibration)
+                {
+                    ESP_LOGI(TAG, "Calibrating ON level:  VAL %.1f", m_on_level);
+                }
+            }
+
+            if (value < m_off_level)
+            {
+                m_off_level = value;
+
+                if (!m_validating_calibration)
+                {
+                    ESP_LOGI(TAG, "Calibrating OFF level:  VAL %.1f", m_off_level);
+                }
+            }
+        }
+
+        ++m_level_value_counter;
+
+        if (m_level_value_counter == m_num_captured_values)
+        {
+            if (m_validating_calibration)
+            {
+                m_validating_calibration = false;
+
+                if (stored_calibration_matches())
+                {
+                    ESP_LOGI(TAG, "Stored analog calibration confirmed:  OFF %.1f  ON %.1f", m_off_level, m_on_level);
+                }
+                else
+                {
+                    ESP_LOGW(
+                        TAG, "Live analog signal disagrees with stored calibration (OFF %.1f  ON %.1f), starting full calibration",
+                        m_off_level, m_on_level);
+
+                    m_level_value_counter = 0;
+                    m_iteration_counter = 0;
+                }
+            }
+            else if ((m_on_level >= m_off_level) && ((m_on_level - m_off_level) >= m_min_level_distance))
+            {
+                float threshold = (m_off_level + m_on_level) / 2;
+                set_analog_threshold(threshold);
+
+                ESP_LOGI(TAG, "Automatic analog calibration finished:  OFF %.1f  ON %.1f  TRSH %.1f", m_off_level, m_on_level, threshold);
+                set_analog_calibration_state(false, m_on_level - m_off_level);
+
+                if (m_persist_calibration)
+                {
+                    store_calibration(threshold);
+                }
+            }
+            else if (m_iteration_counter < m_max_iterations)
+            {
+                ESP_LOGW(TAG, "Insufficient data for analog calibration, starting over");
+                m_level_value_counter = 0;
+            }
+            else
+            {
+                ESP_LOGE(TAG, "Too many failed analog calibration iterations, giving up");
+                set_analog_calibration_state(false, m_on_level - m_off_level, true);
+            }
+        }
+    }
+
+    void FerrarisMeter::set_analog_threshold(float threshold)
+    {
+#ifdef USE_NUMBER
+        if (m_analog_input_threshold_number != nullptr)
+        {
+            m_analog_input_threshold_number->publish_state(threshold);
+            return;
+        }
+#endif
+
+        m_analog_input_threshold = threshold;
+    }
+
+    void FerrarisMeter::store_calibration(float threshold)
+    {
+        m_calibration_data.off_level = m_off_level;
+        m_calibration_data.on_level = m_on_level;
+        m_calibration_data.threshold = threshold;
+
+        // only a synchronized system time yields a meaningful timestamp
+        time_t now = ::time(nullptr);
+        m_calibration_data.timestamp = (now >= MIN_VALID_TIMESTAMP) ? static_cast<uint32_t>(now) : 0;
+        m_calibration_data.checksum = calculate_checksum(m_calibration_data);
+
+        if (m_calibration_preference.save(&m_calibration_data))
+        {
+            ESP_LOGI(TAG, "Stored analog calibration:  OFF %.1f  ON %.1f  TRSH %.1f", m_off_level, m_on_level, threshold);
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Failed to store analog calibration");
+        }
+    }
+
+    bool FerrarisMeter::restore_calibration()
+    {
+        if (!m_calibration_preference.load(&m_calibration_data))
+        {
+            ESP_LOGI(TAG, "No stored analog calibration found");
+            return false;
+        }
+
+        if ((m_calibration_data.checksum != calculate_checksum(m_calibration_data)) ||
+            (m_calibration_data.on_level < m_calibration_data.off_level))
+        {
+            ESP_LOGW(TAG, "Stored analog calibration is invalid");
+            return false;
+        }
+
+        set_analog_threshold(m_calibration_data.threshold);
+
+        ESP_LOGI(
+            TAG, "Restored analog calibration:  OFF %.1f  ON %.1f  TRSH %.1f  TIME %u",
+            m_calibration_data.off_level, m_calibration_data.on_level, m_calibration_data.threshold, m_calibration_data.timestamp);
+        set_analog_calibration_state(false, m_calibration_data.on_level - m_calibration_data.off_level);
+
+        return true;
+    }
+
+    bool FerrarisMeter::stored_calibration_matches() const
+    {
+        float stored_range = m_calibration_data.on_level - m_calibration_data.off_level;
+
+        // signal never falls below the threshold, the marker would be detected permanently
+        if (m_off_level > m_calibration_data.threshold)
+        {
+            return false;
+        }
+
+        // ambient light or sensor mount changed significantly
+        if (std::fabs(m_off_level - m_calibration_data.off_level) > stored_range / 2)
+        {
+            return false;
+        }
+
+        // marker was seen during validation, but does not reach the threshold anymore
+        if (((m_on_level - m_off_level) >= m_min_level_distance) && (m_on_level < m_calibration_data.threshold))
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    // FNV-1a over the given number of leading bytes
+    static uint32_t calculate_fnv1a(const void *data, size_t size)
+    {
+        const uint8_t *bytes = reinterpret_cast<const uint8_t*>(data);
+        uint32_t hash = 2166136261UL;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 16777619UL;
+        }
+
+        return hash;
+    }
+
+    uint32_t FerrarisMeter::calculate_checksum(const CalibrationData &data)
+    {
+        // all fields except the checksum itself
+        return calculate_fnv1a(&data, offsetof(CalibrationData, checksum));
+    }
+
+    uint32_t FerrarisMeter::calculate_checksum(const EnergyRegistersData &data)
+    {
+        return calculate_fnv1a(&data, offsetof(EnergyRegistersData, checksum));
+    }
+
+    void FerrarisMeter::report_period_estimate()
+    {
+        uint32_t now = millis();
+        bool valid = m_period_detector->update_estimate();
+        float period = valid ? get_rotation_period_estimate() : NAN;
+        float confidence = m_period_detector->get_confidence();
+        float deviation = NAN;
+
+        if (valid)
+        {
+            ESP_LOGD(TAG, "Estimated rotation period:  %.0f ms  CONF %.0f %%", period, confidence * 100);
+
+            // cross-check the number of rotations detected via the threshold since the last report
+            if ((confidence >= m_min_period_confidence) && (m_period_report_time >= 0) && !m_calibration_mode)
+            {
+                float detected = static_cast<float>(m_period_report_marks) / m_mark_segments.get_num_marks();
+                float expected = get_duration(m_period_report_time, now) / period;
+                deviation = detected - expected;
+
+                if (std::fabs(deviation) > ROTATION_COUNT_TOLERANCE)
+                {
+                    ESP_LOGW(
+                        TAG, "Detected rotations deviate from estimated period:  %.1f detected, %.1f expected",
+                        detected, expected);
+                }
+            }
+        }
+        else
+        {
+            ESP_LOGD(TAG, "No rotation period found in analog signal");
+        }
+
+        m_period_report_time = now;
+        m_period_report_marks = 0;
+
+#ifdef USE_SENSOR
+        if (m_rotation_period_estimate_sensor != nullptr)
+        {
+            m_rotation_period_estimate_sensor->publish_state(period);
+        }
+
+        if (m_rotation_period_confidence_sensor != nullptr)
+        {
+            m_rotation_period_confidence_sensor->publish_state(confidence * 100);
+        }
+
+        if ((m_rotation_count_deviation_sensor != nullptr) && !std::isnan(deviation))
+        {
+            m_rotation_count_deviation_sensor->publish_state(deviation);
+        }
+#endif
+    }
+
+    float FerrarisMeter::get_rotation_period_estimate() const
+    {
+        float period = m_period_detector->get_period();
+        uint8_t num_marks = m_mark_segments.get_num_marks();
+        uint32_t rotation_time = m_mark_segments.get_last_rotation_time();
+
+        if ((num_marks > 1) && (period > 0.0f) && (rotation_time > 0))
+        {
+            // with several marks, the strongest periodicity may be the mark spacing instead of the full rotation
+            float marks_per_period = std::round(num_marks * period / rotation_time);
+            marks_per_period = std::clamp(marks_per_period, 1.0f, static_cast<float>(num_marks));
+
+            period *= num_marks / marks_per_period;
+        }
+
+        return period;
+    }
+
+    void FerrarisMeter::check_rotation_time(uint32_t rotation_time)
+    {
+        if ((m_period_detector != nullptr) && (m_period_detector->get_period() > 0.0f) &&
+            (m_period_detector->get_confidence() >= m_min_period_confidence))
+        {
+            float period = get_rotation_period_estimate();
+
+            if (std::fabs(rotation_time - period) > ROTATION_TIME_TOLERANCE * period)
+            {
+                ESP_LOGW(
+                    TAG, "Rotation time deviates from estimated period:  %u ms vs. %.0f ms",
+                    rotation_time, period);
+            }
+        }
+    }
+
+    void FerrarisMeter::update_signal_quality(float value, bool previous_state, bool state)
+    {
+        if (state == previous_state)
+        {
+            // values of the first sample after a state change are mostly transitional
+            (state ? m_on_level_statistics : m_off_level_statistics).update(value, LEVEL_STATISTICS_ALPHA);
+        }
+        else
+        {
+            // positive margins mean that the value is clearly beyond the switching point
+            float switching_level = state
+                                        ? m_analog_input_threshold + m_on_tolerance
+                                        : m_analog_input_threshold - m_off_tolerance;
+
+            m_crossing_margin = state ? value - m_analog_input_threshold : m_analog_input_threshold - value;
+            m_hysteresis_margin = state ? value - switching_level : switching_level - value;
+            m_threshold_excursion = false;
+        }
+
+        // crossing the threshold and back within the hysteresis band without a state change
+        bool above_threshold = (value > m_analog_input_threshold);
+
+        if ((above_threshold != m_above_threshold) && (state == previous_state))
+        {
+            if (m_threshold_excursion)
+            {
+                m_threshold_flaps++;
+            }
+
+            m_threshold_excursion = !m_threshold_excursion;
+        }
+
+        m_above_threshold = above_threshold;
+    }
+
+    void FerrarisMeter::publish_signal_quality()
+    {
+        bool valid = (m_on_level_statistics.count > 0) && (m_off_level_statistics.count > 0);
+        float separation = valid ? m_on_level_statistics.mean - m_off_level_statistics.mean : NAN;
+        float on_noise = (m_on_level_statistics.count > 0) ? std::sqrt(m_on_level_statistics.variance) : NAN;
+        float off_noise = (m_off_level_statistics.count > 0) ? std::sqrt(m_off_level_statistics.variance) : NAN;
+
+        ESP_LOGD(
+            TAG, "Signal quality:  SEP %.1f  NOISE ON %.2f OFF %.2f  MARGIN %.1f/%.1f  FLAPS %u",
+            separation, on_noise, off_noise, m_crossing_margin, m_hysteresis_margin, m_threshold_flaps);
+
+#ifdef USE_SENSOR
+        if (m_analog_level_separation_sensor != nullptr)
+        {
+            m_analog_level_separation_sensor->publish_state(separation);
+        }
+
+        if (m_analog_on_noise_sensor != nullptr)
+        {
+            m_analog_on_noise_sensor->publish_state(on_noise);
+        }
+
+        if (m_analog_off_noise_sensor != nullptr)
+        {
+            m_analog_off_noise_sensor->publish_state(off_noise);
+        }
+
+        if (m_analog_crossing_margin_sensor != nullptr)
+        {
+            m_analog_crossing_margin_sensor->publish_state(m_crossing_margin);
+        }
+
+        if (m_analog_hysteresis_margin_sensor != nullptr)
+        {
+            m_analog_hysteresis_margin_sensor->publish_state(m_hysteresis_margin);
+        }
+
+        if (m_analog_threshold_flaps_sensor != nullptr)
+        {
+            m_analog_threshold_flaps_sensor->publish_state(m_threshold_flaps);
+        }
+#endif
+    }
+
+    bool FerrarisMeter::has_signal_quality_sensors() const
+    {
+#ifdef USE_SENSOR
+        return (m_analog_level_separation_sensor != nullptr) ||
+               (m_analog_on_noise_sensor != nullptr) ||
+               (m_analog_off_noise_sensor != nullptr) ||
+               (m_analog_crossing_margin_sensor != nullptr) ||
+               (m_analog_hysteresis_margin_sensor != nullptr) ||
+               (m_analog_threshold_flaps_sensor != nullptr);
+#else
+        return false;
 #endif
     }
 
@@ -39,13 +39,77 @@
 #ifdef USE_NUMBER
 #include "esphome/components/number/number.h"
 #endif
+#ifdef USE_TIME
+#include "esphome/components/time/real_time_clock.h"
+#endif
 #include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/preferences.h"
+
+#include "energy_registers.h"
+#include "mark_segments.h"
+#include "period_detector.h"
+#include "publish_scheduler.h"
+#include "sample_capture.h"
 
+#include <array>
 #include <limits>
+#include <memory>
+#include <string>
 
 
 namespace esphome::ferraris
 {
+    enum PollingMode : uint8_t
+    {
+        POLLING_MODE_NORMAL,
+        POLLING_MODE_HIGH_FREQUENCY,
+        POLLING_MODE_ADAPTIVE
+    };
+
+    struct CalibrationData
+    {
+        float off_level;
+        float on_level;
+        float threshold;
+        uint32_t timestamp;
+        uint32_t checksum;
+    };
+
+    struct EnergyRegistersData
+    {
+        uint64_t tariff_rotations[EnergyRegisters::MAX_TARIFFS];
+        uint32_t num_tariffs;
+        uint32_t checksum;
+    };
+
+    struct LevelStatistics
+    {
+        // exponentially weighted mean and variance of the analog values within one state
+        void update(float value, float alpha)
+        {
+            if (count == 0)
+            {
+                mean = value;
+                variance = 0.0f;
+            }
+            else
+            {
+                float diff = value - mean;
+                float increment = alpha * diff;
+
+                mean += increment;
+                variance = (1.0f - alpha) * (variance + diff * increment);
+            }
+
+            ++count;
+        }
+
+        float mean{0.0f};
+        float variance{0.0f};
+        uint32_t count{0};
+    };
+
     class FerrarisMeter : public Component
     {
     public:
@@ -63,6 +127,23 @@ namespace esphome::ferraris
         void set_energy_meter(float value);
         void set_rotation_counter(uint64_t value);
 
+        float get_power_estimate(uint32_t now) const;
+        float get_energy() const;
+        bool has_energy_baseline() const;
+        // maximum power which can be resolved reliably with the current configuration and sampling
+        float get_max_power() const;
+
+        // tariffs are numbered starting from 1
+        void set_tariff(uint8_t tariff);
+        uint8_t get_tariff() const;
+        float get_tariff_energy(uint8_t tariff) const;
+        // 0 is the current (incomplete) hour, 1 the previous hour and so on
+        float get_hourly_energy(uint8_t hours_ago) const;
+        void log_energy_registers() const;
+
+        void start_sample_capture(uint32_t duration);
+        void dump_sample_capture();
+
         void start_analog_calibration(
                 uint32_t num_captured_values,
                 float min_level_dist,
@@ -74,6 +155,37 @@ namespace esphome::ferraris
 
             m_level_value_counter = 0;
             m_iteration_counter = 0;
+            m_validating_calibration = false;
+        }
+
+        void set_persist_calibration(const std::string &key)
+        {
+            m_persist_calibration = true;
+            m_calibration_key = key;
+        }
+
+        void set_energy_registers(uint8_t num_tariffs, const std::string &key)
+        {
+            m_energy_registers = std::make_unique<EnergyRegisters>(num_tariffs);
+            m_energy_registers_key = key;
+        }
+
+        void add_tariff_schedule_entry(uint32_t second_of_day, uint8_t tariff)
+        {
+            if (m_energy_registers != nullptr)
+            {
+                m_energy_registers->add_schedule_entry(second_of_day, tariff - 1);
+            }
+        }
+
+        void set_period_detection(
+                uint8_t decimation,
+                uint16_t window_size,
+                uint16_t max_lag,
+                float min_confidence)
+        {
+            m_period_detector = std::make_unique<PeriodDetector>(decimation, window_size, max_lag);
+            m_min_period_confidence = min_confidence;
         }
 
 #ifdef USE_SENSOR
@@ -87,20 +199,121 @@ namespace esphome::ferraris
             m_analog_input_sensor = sensor;
         }
 
+        void set_analog_input_interval(uint32_t interval)
+        {
+            m_analog_input_interval = interval;
+        }
+
         void set_power_consumption_sensor(sensor::Sensor *sensor)
         {
-            m_power_consumption_sensor = sensor;
+            m_power_consumption_channel.set_sensor(sensor);
         }
 
         void set_energy_meter_sensor(sensor::Sensor *sensor)
         {
-            m_energy_meter_sensor = sensor;
+            m_energy_meter_channel.set_sensor(sensor);
+        }
+
+        void set_power_consumption_publish_policy(
+                float deadband,
+                bool deadband_percent,
+                uint32_t min_interval,
+                uint32_t max_interval)
+        {
+            m_power_consumption_channel.set_policy(deadband, deadband_percent, min_interval, max_interval);
+        }
+
+        void set_energy_meter_publish_policy(
+                float deadband,
+                bool deadband_percent,
+                uint32_t min_interval,
+                uint32_t max_interval)
+        {
+            m_energy_meter_channel.set_policy(deadband, deadband_percent, min_interval, max_interval);
+        }
+
+        void set_publish_reduction_sensor(sensor::Sensor *sensor)
+        {
+            m_publish_reduction_sensor = sensor;
+        }
+
+        void set_tariff_energy_sensor(uint8_t tariff, sensor::Sensor *sensor)
+        {
+            if ((tariff >= 1) && (tariff <= EnergyRegisters::MAX_TARIFFS))
+            {
+                m_tariff_energy_sensors[tariff - 1] = sensor;
+            }
+        }
+
+        void set_active_tariff_sensor(sensor::Sensor *sensor)
+        {
+            m_active_tariff_sensor = sensor;
+        }
+
+        void set_previous_hour_energy_sensor(sensor::Sensor *sensor)
+        {
+            m_previous_hour_energy_sensor = sensor;
+        }
+
+        void set_max_power_sensor(sensor::Sensor *sensor)
+        {
+            m_max_power_sensor = sensor;
+        }
+
+        void set_timing_error_sensor(sensor::Sensor *sensor)
+        {
+            m_timing_error_sensor = sensor;
         }
 
         void set_analog_value_spectrum_sensor(sensor::Sensor *sensor)
         {
             m_analog_value_spectrum_sensor = sensor;
         }
+
+        void set_rotation_period_estimate_sensor(sensor::Sensor *sensor)
+        {
+            m_rotation_period_estimate_sensor = sensor;
+        }
+
+        void set_rotation_period_confidence_sensor(sensor::Sensor *sensor)
+        {
+            m_rotation_period_confidence_sensor = sensor;
+        }
+
+        void set_rotation_count_deviation_sensor(sensor::Sensor *sensor)
+        {
+            m_rotation_count_deviation_sensor = sensor;
+        }
+
+        void set_analog_level_separation_sensor(sensor::Sensor *sensor)
+        {
+            m_analog_level_separation_sensor = sensor;
+        }
+
+        void set_analog_on_noise_sensor(sensor::Sensor *sensor)
+        {
+            m_analog_on_noise_sensor = sensor;
+        }
+
+        void set_analog_off_noise_sensor(sensor::Sensor *sensor)
+        {
+            m_analog_off_noise_sensor = sensor;
+        }
+
+        void set_analog_crossing_margin_sensor(sensor::Sensor *sensor)
+        {
+            m_analog_crossing_margin_sensor = sensor;
+        }
+
+        void set_analog_hysteresis_margin_sensor(sensor::Sensor *sensor)
+        {
+            m_analog_hysteresis_margin_sensor = sensor;
+        }
+
+        void set_analog_threshold_flaps_sensor(sensor::Sensor *sensor)
+        {
+            m_analog_threshold_flaps_sensor = sensor;
+        }
 #endif
 
 #ifdef USE_BINARY_SENSOR
@@ -118,6 +331,11 @@ namespace esphome::ferraris
         {
             m_analog_calibration_result_sensor = sensor;
         }
+
+        void set_capacity_warning_sensor(binary_sensor::BinarySensor *sensor)
+        {
+            m_capacity_warning_sensor = sensor;
+        }
 #endif
 
 #ifdef USE_SWITCH
@@ -127,6 +345,13 @@ namespace esphome::ferraris
         }
 #endif
 
+#ifdef USE_TIME
+        void set_time(time::RealTimeClock *time)
+        {
+            m_time = time;
+        }
+#endif
+
 #ifdef USE_NUMBER
         void set_analog_input_threshold_number(number::Number* threshold_number)
         {
@@ -174,11 +399,73 @@ namespace esphome::ferraris
             m_debounce_threshold = threshold;
         }
 
+        void set_energy_start_value_timeout(uint32_t timeout)
+        {
+            m_energy_start_value_timeout = timeout;
+        }
+
+        void set_signal_quality_interval(uint32_t interval)
+        {
+            m_signal_quality_interval = interval;
+        }
+
+        void set_publish_interval(uint32_t interval)
+        {
+            m_publish_interval = interval;
+        }
+
+        void set_capture_buffer_size(uint32_t size)
+        {
+            m_capture_buffer_size = size;
+        }
+
+        void set_polling_mode(PollingMode mode)
+        {
+            m_polling_mode = mode;
+        }
+
+        void set_marks_per_rotation(uint8_t marks)
+        {
+            m_mark_segments.set_num_marks(marks);
+        }
+
 
     private:
         void update_power_consumption(uint32_t rotation_time);
-        void update_energy_counter();
+        void update_energy_counter(bool immediate = false);
+        void publish_publish_reduction();
+        void update_energy_registers();
+        bool sync_energy_registers();
+        void publish_energy_registers(bool rollover);
+        void store_energy_registers();
+        void restore_energy_registers();
+        void capture_sample(float value);
+        void update_sample_interval(uint32_t now);
+        void update_adaptive_polling(uint32_t now);
+        bool needs_high_frequency_polling(uint32_t now);
+        void update_polling_prediction(uint32_t segment_time);
+        void update_marker_width(uint32_t now);
+        void dump_capture_chunk();
+        float get_sample_interval() const;
+        float get_min_rotation_time() const;
+        float get_timing_error(uint32_t rotation_time) const;
+        void check_capacity(float power);
+        void publish_capacity();
+        bool has_capacity_sensors() const;
         void set_analog_calibration_state(bool running, float range = 0, bool problem = false);
+        void process_calibration_value(float value);
+        void set_analog_threshold(float threshold);
+        void store_calibration(float threshold);
+        bool restore_calibration();
+        bool stored_calibration_matches() const;
+        static uint32_t calculate_checksum(const CalibrationData &data);
+        static uint32_t calculate_checksum(const EnergyRegistersData &data);
+        void report_period_estimate();
+        float get_rotation_period_estimate() const;
+        void update_signal_quality(float value, bool previous_state, bool state);
+        void publish_signal_quality();
+        bool has_signal_quality_sensors() const;
+        void check_rotation_time(uint32_t rotation_time);
 
         static inline uint32_t get_duration(uint32_t time1, uint32_t time2)
         {
@@ -200,18 +487,37 @@ namespace esphome::ferraris
         InternalGPIOPin* m_digital_input_pin;
 #ifdef USE_SENSOR
         sensor::Sensor* m_analog_input_sensor;
-        sensor::Sensor* m_power_consumption_sensor;
-        sensor::Sensor* m_energy_meter_sensor;
+        PublishChannel m_power_consumption_channel;
+        PublishChannel m_energy_meter_channel;
         sensor::Sensor* m_analog_value_spectrum_sensor;
+        sensor::Sensor* m_rotation_period_estimate_sensor;
+        sensor::Sensor* m_rotation_period_confidence_sensor;
+        sensor::Sensor* m_rotation_count_deviation_sensor;
+        sensor::Sensor* m_analog_level_separation_sensor;
+        sensor::Sensor* m_analog_on_noise_sensor;
+        sensor::Sensor* m_analog_off_noise_sensor;
+        sensor::Sensor* m_analog_crossing_margin_sensor;
+        sensor::Sensor* m_analog_hysteresis_margin_sensor;
+        sensor::Sensor* m_analog_threshold_flaps_sensor;
+        sensor::Sensor* m_publish_reduction_sensor;
+        std::array<sensor::Sensor*, EnergyRegisters::MAX_TARIFFS> m_tariff_energy_sensors;
+        sensor::Sensor* m_active_tariff_sensor;
+        sensor::Sensor* m_previous_hour_energy_sensor;
+        sensor::Sensor* m_max_power_sensor;
+        sensor::Sensor* m_timing_error_sensor;
 #endif
 #ifdef USE_BINARY_SENSOR
         binary_sensor::BinarySensor* m_rotation_indicator_sensor;
         binary_sensor::BinarySensor* m_analog_calibration_state_sensor;
         binary_sensor::BinarySensor* m_analog_calibration_result_sensor;
+        binary_sensor::BinarySensor* m_capacity_warning_sensor;
 #endif
 #ifdef USE_SWITCH
         switch_::Switch* m_calibration_mode_switch;
 #endif
+#ifdef USE_TIME
+        time::RealTimeClock* m_time;
+#endif
 #ifdef USE_NUMBER
         number::Number* m_analog_input_threshold_number;
         number::Number* m_off_tolerance_number;
@@ -225,11 +531,14 @@ namespace esphome::ferraris
         float m_on_tolerance;
         uint32_t m_rotations_per_kwh;
         uint32_t m_debounce_threshold;
+        uint32_t m_energy_start_value_timeout;
 
         bool m_last_state;
         int64_t m_last_time;
         int64_t m_last_rising_time;
         uint64_t m_rotation_counter;
+        MarkSegments m_mark_segments;
+        float m_last_power;
 
         float m_off_level;
         float m_on_level;
@@ -239,6 +548,57 @@ namespace esphome::ferraris
         uint8_t m_iteration_counter;
         uint32_t m_level_value_counter;
 
+        ESPPreferenceObject m_calibration_preference;
+        CalibrationData m_calibration_data;
+        std::string m_calibration_key;
+        bool m_persist_calibration;
+        bool m_validating_calibration;
+
+        std::unique_ptr<PeriodDetector> m_period_detector;
+        float m_min_period_confidence;
+        int64_t m_period_report_time;
+        uint32_t m_period_report_marks;
+
+        uint32_t m_signal_quality_interval;
+        LevelStatistics m_on_level_statistics;
+        LevelStatistics m_off_level_statistics;
+        float m_crossing_margin;
+        float m_hysteresis_margin;
+        uint32_t m_threshold_flaps;
+        bool m_above_threshold;
+        bool m_threshold_excursion;
+
+        uint32_t m_publish_interval;
+        uint32_t m_publish_statistics_updates;
+        uint32_t m_publish_statistics_publishes;
+
+        std::unique_ptr<EnergyRegisters> m_energy_registers;
+        std::string m_energy_registers_key;
+        ESPPreferenceObject m_energy_registers_preference;
+        int m_scheduled_tariff;
+        int64_t m_hour_key;
+        uint32_t m_hour_start_time;
+
+        SampleCapture m_sample_capture;
+        uint32_t m_capture_buffer_size;
+        uint8_t m_capture_events;
+        CaptureHeader m_capture_header;
+        uint32_t m_capture_dump_offset;
+
+        PollingMode m_polling_mode;
+        HighFrequencyLoopRequester m_high_frequency_loop;
+        bool m_high_frequency_active;
+        uint32_t m_segment_time;
+        float m_marker_ratio;
+        float m_window_ratio;
+        bool m_marker_open;
+        bool m_window_missed;
+        float m_loop_interval;
+        float m_sample_interval;
+        uint32_t m_analog_input_interval;
+        int64_t m_last_sample_time;
+        bool m_capacity_warning;
+
         bool m_calibration_mode;
         bool m_start_value_received;
     };
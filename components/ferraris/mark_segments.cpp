@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include "mark_segments.h"
+#include "esphome/core/log.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace esphome::ferraris
+{
+    static constexpr const char *const TAG = "ferraris";
+
+    // weight of a new rotation in the learned shares once the initial learning phase is over
+    static constexpr const float    SHARE_SMOOTHING        = 0.1f;
+    // number of rotations until the learned shares are used for realignment
+    static constexpr const uint32_t LEARNING_ROTATIONS     = 5;
+    // maximum mean squared deviation from the learned shares, relative to the average share
+    static constexpr const float    SHARE_TOLERANCE        = 0.04f;
+    // number of consecutive deviating rotations after which the shares are learned anyway
+    static constexpr const uint8_t  MAX_REJECTED_ROTATIONS = 3;
+    // minimum distance of the elapsed time from the midpoint between a missed and a spurious mark, relative to the rotation time
+    static constexpr const float    SHIFT_DECISION_MARGIN  = 0.25f;
+
+    MarkSegments::MarkSegments()
+        : m_num_marks(1)
+        , m_index(0)
+        , m_num_durations(0)
+        , m_rejected_rotations(0)
+        , m_learned_rotations(0)
+        , m_aligned(false)
+        , m_reference_time(0)
+        , m_pending_marks(0)
+        , m_pending_time(0)
+        , m_durations{}
+        , m_shares{}
+    {
+        m_shares[0] = 1.0f;
+    }
+
+    void MarkSegments::set_num_marks(uint8_t num_marks)
+    {
+        m_num_marks = std::clamp<uint8_t>(num_marks, 1, MAX_MARKS);
+        m_learned_rotations = 0;
+        m_rejected_rotations = 0;
+
+        for (uint8_t segment = 0; segment < MAX_MARKS; ++segment)
+        {
+            m_shares[segment] = (segment < m_num_marks) ? 1.0f / m_num_marks : 0.0f;
+        }
+
+        reset();
+    }
+
+    void MarkSegments::reset()
+    {
+        // the learned shares remain valid, the numbering is adopted silently with the next rotation
+        m_index = 0;
+        m_num_durations = 0;
+        m_aligned = false;
+        m_reference_time = 0;
+        m_pending_marks = 0;
+        m_pending_time = 0;
+    }
+
+    bool MarkSegments::add_segment(uint32_t duration)
+    {
+        m_durations[m_index] = duration;
+        m_index = (m_index + 1) % m_num_marks;
+
+        if (m_num_durations < m_num_marks)
+        {
+            ++m_num_durations;
+        }
+
+        ++m_pending_marks;
+        m_pending_time += duration;
+
+        if (m_index != 0)
+        {
+            return false;
+        }
+
+        uint32_t rotation_time = get_last_rotation_time();
+        if ((m_num_marks == 1) || (rotation_time == 0))
+        {
+            return true;
+        }
+
+        bool completed = true;
+
+        if (is_learned())
+        {
+            float error = get_share_error(rotation_time, 0);
+
+            if ((error <= SHARE_TOLERANCE) && !is_steady(rotation_time))
+            {
+                if (++m_rejected_rotations < MAX_REJECTED_ROTATIONS)
+                {
+                    // either a load change or a missed or spurious mark that happens to match the shares
+                    ESP_LOGD(TAG, "Rotation time deviates from last consistent rotation, skipping rotation");
+                    return true;
+                }
+            }
+            else if (error > SHARE_TOLERANCE)
+            {
+                // check whether a missed or spurious mark shifted the numbering of the segments
+                uint8_t best_shift = 0;
+                float best_error = error;
+                uint8_t num_matches = 0;
+
+                for (uint8_t shift = 1; shift < m_num_marks; ++shift)
+                {
+                    float shift_error = get_share_error(rotation_time, shift);
+
+                    if (shift_error <= SHARE_TOLERANCE)
+                    {
+                        ++num_matches;
+                    }
+
+                    if (shift_error < best_error)
+                    {
+                        best_shift = shift;
+                        best_error = shift_error;
+                    }
+                }
+
+                bool matched = (best_shift != 0) && (best_error <= SHARE_TOLERANCE);
+                bool missed = false;
+
+                if (matched && !m_aligned)
+                {
+                    // the numbering after a reset is arbitrary, so just adopt it
+                    rotate_shares(best_shift);
+                }
+                else if (matched && (num_matches == 1) && get_shift_cause(best_shift, missed))
+                {
+                    std::array<uint32_t, MAX_MARKS> durations = m_durations;
+
+                    for (uint8_t segment = 0; segment < m_num_marks; ++segment)
+                    {
+                        m_durations[(segment + best_shift) % m_num_marks] = durations[segment];
+                    }
+
+                    m_index = best_shift;
+
+                    // after missed marks, the rotation has already been completed with the previous mark;
+                    // after spurious marks, it only completes when the numbering wraps around the next time
+                    completed = missed;
+
+                    ESP_LOGW(
+                        TAG, "Realigned mark segments after %d %s mark(s)",
+                        missed ? best_shift : m_num_marks - best_shift, missed ? "missed" : "spurious");
+                }
+                else if (matched)
+                {
+                    // keep the numbering and the rotation count, only the boundary of the rotation moves
+                    rotate_shares(best_shift);
+
+                    ESP_LOGW(
+                        TAG, "Mark segments shifted by %d, unable to tell missed from spurious marks, keeping rotation count",
+                        best_shift);
+                }
+                else if (++m_rejected_rotations < MAX_REJECTED_ROTATIONS)
+                {
+                    // most likely a load change within the rotation, don't learn from it
+                    ESP_LOGD(TAG, "Segment durations deviate from learned shares, skipping rotation");
+                    return true;
+                }
+                else
+                {
+                    ESP_LOGW(TAG, "Segment durations persistently deviate from learned shares, relearning");
+                }
+            }
+        }
+
+        update_shares(rotation_time);
+        m_rejected_rotations = 0;
+        m_aligned = true;
+        m_reference_time = rotation_time;
+
+        // the time since the last rotation boundary is covered by the segments before the current one
+        m_pending_marks = m_index;
+        m_pending_time = 0;
+
+        for (uint8_t segment = 0; segment < m_index; ++segment)
+        {
+            m_pending_time += m_durations[segment];
+        }
+
+        return completed;
+    }
+
+    uint32_t MarkSegments::get_last_rotation_time() const
+    {
+        if (m_num_durations < m_num_marks)
+        {
+            return 0;
+        }
+
+        uint32_t rotation_time = 0;
+        for (uint8_t segment = 0; segment < m_num_marks; ++segment)
+        {
+            rotation_time += m_durations[segment];
+        }
+
+        return rotation_time;
+    }
+
+    float MarkSegments::get_min_share() const
+    {
+        return *std::min_element(m_shares.begin(), m_shares.begin() + m_num_marks);
+    }
+
+    bool MarkSegments::is_learned() const
+    {
+        return (m_num_marks == 1) || (m_learned_rotations >= LEARNING_ROTATIONS);
+    }
+
+    float MarkSegments::get_share_error(uint32_t rotation_time, uint8_t shift) const
+    {
+        float sum = 0.0f;
+
+        for (uint8_t segment = 0; segment < m_num_marks; ++segment)
+        {
+            float diff = static_cast<float>(m_durations[segment]) / rotation_time - m_shares[(segment + shift) % m_num_marks];
+            sum += diff * diff;
+        }
+
+        return sum * m_num_marks;
+    }
+
+    bool MarkSegments::is_steady(uint32_t rotation_time) const
+    {
+        // a missed or spurious mark changes the rotation time by at least the smallest share
+        return (m_reference_time == 0)
+                    || (std::fabs(static_cast<float>(rotation_time) - m_reference_time) <= m_reference_time * get_min_share() / 2);
+    }
+
+    bool MarkSegments::get_shift_cause(uint8_t shift, bool &missed) const
+    {
+        if (m_reference_time == 0)
+        {
+            return false;
+        }
+
+        // time expected for passing the marks up to the shifted position, starting at the last rotation boundary
+        float partial = 0.0f;
+        for (uint8_t segment = 0; segment < shift; ++segment)
+        {
+            partial += m_shares[segment];
+        }
+
+        // both explanations end at the same mark, but spurious marks account for one rotation less than missed ones
+        uint32_t spurious_rotations = (m_pending_marks + shift) / m_num_marks - 1;
+        float expected = (spurious_rotations + partial) * m_reference_time;
+        float excess = (static_cast<float>(m_pending_time) - expected) / m_reference_time;
+
+        if (std::fabs(excess - 0.5f) < SHIFT_DECISION_MARGIN)
+        {
+            return false;
+        }
+
+        missed = (excess > 0.5f);
+        return true;
+    }
+
+    void MarkSegments::rotate_shares(uint8_t shift)
+    {
+        std::array<float, MAX_MARKS> shares = m_shares;
+
+        for (uint8_t segment = 0; segment < m_num_marks; ++segment)
+        {
+            m_shares[segment] = shares[(segment + shift) % m_num_marks];
+        }
+    }
+
+    void MarkSegments::update_shares(uint32_t rotation_time)
+    {
+        // plain average during the learning phase, exponential smoothing afterwards
+        float alpha = std::max(1.0f / (m_learned_rotations + 1), SHARE_SMOOTHING);
+        float sum = 0.0f;
+
+        for (uint8_t segment = 0; segment < m_num_marks; ++segment)
+        {
+            float share = static_cast<float>(m_durations[segment]) / rotation_time;
+
+            m_shares[segment] += alpha * (share - m_shares[segment]);
+            sum += m_shares[segment];
+        }
+
+        for (uint8_t segment = 0; segment < m_num_marks; ++segment)
+        {
+            m_shares[segment] /= sum;
+        }
+
+        ++m_learned_rotations;
+    }
+}  // namespace esphome::ferraris
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+
+namespace esphome::ferraris
+{
+    /*
+     * Tracks the segments between several marks on the turntable.
+     *
+     * The angular share of each segment is learned from the durations of
+     * complete rotations, so the power can be derived from every single
+     * segment without a periodic ripple caused by uneven mark spacing. Once
+     * the shares are known, the segment numbering is realigned if a missed
+     * or spurious mark shifted it. The time elapsed since the last consistent
+     * rotation tells whether marks have been missed or are spurious, so the
+     * rotation count can be compensated as well.
+     */
+    class MarkSegments
+    {
+    public:
+        static constexpr const uint8_t MAX_MARKS = 16;
+
+        MarkSegments();
+
+        void set_num_marks(uint8_t num_marks);
+        void reset();
+
+        // registers the duration of the segment ending with the current mark,
+        // returns true if a full rotation has been completed
+        bool add_segment(uint32_t duration);
+
+        // duration of a full rotation extrapolated from the duration of the given segment
+        float get_rotation_time(uint8_t segment, uint32_t duration) const
+        {
+            return duration / m_shares[segment];
+        }
+
+        // sum of the durations of the last complete set of segments (0 if not yet available)
+        uint32_t get_last_rotation_time() const;
+
+        float get_share(uint8_t segment) const
+        {
+            return m_shares[segment];
+        }
+
+        float get_min_share() const;
+
+        // index of the segment which is currently passing
+        uint8_t get_index() const
+        {
+            return m_index;
+        }
+
+        uint8_t get_num_marks() const
+        {
+            return m_num_marks;
+        }
+
+        bool is_learned() const;
+
+    private:
+        // returns the mean squared deviation from the learned shares, normalized to the average share
+        float get_share_error(uint32_t rotation_time, uint8_t shift) const;
+        // checks whether the rotation time matches the last consistent rotation
+        bool is_steady(uint32_t rotation_time) const;
+        // determines whether the given shift stems from missed (true) or spurious (false) marks,
+        // returns false if this cannot be decided
+        bool get_shift_cause(uint8_t shift, bool &missed) const;
+        void rotate_shares(uint8_t shift);
+        void update_shares(uint32_t rotation_time);
+
+        uint8_t m_num_marks;
+        uint8_t m_index;
+        uint8_t m_num_durations;
+        uint8_t m_rejected_rotations;
+        uint32_t m_learned_rotations;
+        bool m_aligned;
+        uint32_t m_reference_time;
+        uint32_t m_pending_marks;
+        uint32_t m_pending_time;
+        std::array<uint32_t, MAX_MARKS> m_durations;
+        std::array<float, MAX_MARKS> m_shares;
+    };
+}  // namespace esphome::ferraris
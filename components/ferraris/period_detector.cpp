@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "period_detector.h"
+
+
+namespace esphome::ferraris
+{
+    static constexpr const float SAMPLE_INTERVAL_SMOOTHING = 0.1f;
+
+    PeriodDetector::PeriodDetector(uint8_t decimation, uint16_t window_size, uint16_t max_lag)
+        : m_decimation(decimation)
+        , m_window_size(window_size)
+        , m_max_lag(max_lag)
+        , m_samples(window_size + max_lag + 1, 0.0f)
+        , m_correlation(max_lag + 1, 0.0f)
+        , m_head(0)
+        , m_num_samples(0)
+        , m_resync_lag(0)
+        , m_report_counter(0)
+        , m_decimation_sum(0.0f)
+        , m_decimation_counter(0)
+        , m_mean(0.0f)
+        , m_last_sample_time(-1)
+        , m_sample_interval(0.0f)
+        , m_period(0.0f)
+        , m_confidence(0.0f)
+    {
+    }
+
+    bool PeriodDetector::add_sample(float value, uint32_t now)
+    {
+        m_decimation_sum += value;
+
+        if (++m_decimation_counter < m_decimation)
+        {
+            return false;
+        }
+
+        float sample = m_decimation_sum / m_decimation;
+        m_decimation_sum = 0.0f;
+        m_decimation_counter = 0;
+
+        if (m_last_sample_time >= 0)
+        {
+            float interval = static_cast<float>(now - static_cast<uint32_t>(m_last_sample_time));
+
+            m_sample_interval = (m_sample_interval > 0.0f)
+                                    ? m_sample_interval + SAMPLE_INTERVAL_SMOOTHING * (interval - m_sample_interval)
+                                    : interval;
+        }
+
+        m_last_sample_time = now;
+
+        // remove the DC component by tracking the mean over roughly one window
+        if (m_num_samples == 0)
+        {
+            m_mean = sample;
+        }
+        else
+        {
+            m_mean += (sample - m_mean) / m_window_size;
+        }
+
+        float centered = sample - m_mean;
+
+        m_head = (m_head + 1) % m_samples.size();
+        m_samples[m_head] = centered;
+
+        if (m_num_samples < m_samples.size())
+        {
+            ++m_num_samples;
+        }
+
+        // add product of the newest sample and remove product leaving the window
+        for (uint32_t lag = 0; lag <= m_max_lag; ++lag)
+        {
+            if (m_num_samples > lag)
+            {
+                m_correlation[lag] += centered * sample_at(lag);
+            }
+
+            if (m_num_samples > m_window_size + lag)
+            {
+                m_correlation[lag] -= sample_at(m_window_size) * sample_at(m_window_size + lag);
+            }
+        }
+
+        if (m_num_samples < m_samples.size())
+        {
+            return false;
+        }
+
+        // exact recomputation of one lag per sample to eliminate drift
+        float sum = 0.0f;
+        for (uint32_t age = 0; age < m_window_size; ++age)
+        {
+            sum += sample_at(age) * sample_at(age + m_resync_lag);
+        }
+
+        m_correlation[m_resync_lag] = sum;
+        m_resync_lag = (m_resync_lag + 1) % (m_max_lag + 1);
+
+        if (++m_report_counter >= m_window_size)
+        {
+            m_report_counter = 0;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool PeriodDetector::update_estimate()
+    {
+        m_period = 0.0f;
+        m_confidence = 0.0f;
+
+        if ((m_num_samples < m_samples.size()) || (m_correlation[0] <= 0.0f) || (m_sample_interval <= 0.0f))
+        {
+            return false;
+        }
+
+        // skip the main lobe around lag 0
+        uint32_t lag = 1;
+        while ((lag <= m_max_lag) && (m_correlation[lag] > 0.0f))
+        {
+            ++lag;
+        }
+
+        uint32_t peak_lag = 0;
+        float peak_value = 0.0f;
+
+        for (; lag <= m_max_lag; ++lag)
+        {
+            if (m_correlation[lag] > peak_value)
+            {
+                peak_lag = lag;
+                peak_value = m_correlation[lag];
+            }
+        }
+
+        // a maximum at the border is not a real peak, the period may be longer than max_lag
+        if ((peak_lag == 0) || (peak_lag == m_max_lag))
+        {
+            return false;
+        }
+
+        // parabolic interpolation for sub-sample resolution
+        float prev = m_correlation[peak_lag - 1];
+        float next = m_correlation[peak_lag + 1];
+        float denominator = prev - 2 * peak_value + next;
+        float offset = (denominator < 0.0f) ? 0.5f * (prev - next) / denominator : 0.0f;
+
+        m_period = (peak_lag + offset) * m_sample_interval;
+        m_confidence = peak_value / m_correlation[0];
+
+        if (m_confidence > 1.0f)
+        {
+            m_confidence = 1.0f;
+        }
+
+        return true;
+    }
+}  // namespace esphome::ferraris
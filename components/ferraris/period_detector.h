@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+
+namespace esphome::ferraris
+{
+    /*
+     * Estimates the rotation period of the turntable from the analog signal by
+     * means of a sliding window autocorrelation over decimated samples.
+     *
+     * The correlation sums are updated incrementally for each decimated sample,
+     * so the cost per sample is bounded by O(max_lag) plus one exact
+     * recomputation of a single lag (round robin) to prevent accumulation of
+     * floating point errors.
+     */
+    class PeriodDetector
+    {
+    public:
+        PeriodDetector(uint8_t decimation, uint16_t window_size, uint16_t max_lag);
+
+        // returns true when a new report (every window_size decimated samples) is due
+        bool add_sample(float value, uint32_t now);
+        bool update_estimate();
+
+        float get_period() const
+        {
+            return m_period;
+        }
+
+        float get_confidence() const
+        {
+            return m_confidence;
+        }
+
+        uint8_t get_decimation() const
+        {
+            return m_decimation;
+        }
+
+        uint16_t get_window_size() const
+        {
+            return m_window_size;
+        }
+
+        uint16_t get_max_lag() const
+        {
+            return m_max_lag;
+        }
+
+    private:
+        float sample_at(uint32_t age) const
+        {
+            return m_samples[(m_head + m_samples.size() - age) % m_samples.size()];
+        }
+
+        uint8_t m_decimation;
+        uint16_t m_window_size;
+        uint16_t m_max_lag;
+
+        std::vector<float> m_samples;
+        std::vector<float> m_correlation;
+        uint32_t m_head;
+        uint32_t m_num_samples;
+        uint16_t m_resync_lag;
+        uint16_t m_report_counter;
+
+        float m_decimation_sum;
+        uint8_t m_decimation_counter;
+        float m_mean;
+        int64_t m_last_sample_time;
+        float m_sample_interval;
+
+        float m_period;
+        float m_confidence;
+    };
+}  // namespace esphome::ferraris
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include "publish_scheduler.h"
+#include "esphome/core/log.h"
+
+#include <cmath>
+#include <limits>
+
+
+namespace esphome::ferraris
+{
+#ifdef USE_SENSOR
+    static constexpr const char *const TAG = "ferraris";
+
+    PublishChannel::PublishChannel()
+        : m_sensor(nullptr)
+        , m_scheduled(false)
+        , m_deadband(0.0f)
+        , m_deadband_percent(false)
+        , m_min_interval(0)
+        , m_max_interval(0)
+        , m_value(NAN)
+        , m_pending(false)
+        , m_published_value(NAN)
+        , m_last_publish_time(-1)
+        , m_num_updates(0)
+        , m_num_publishes(0)
+    {
+    }
+
+    bool PublishChannel::update(float value, uint32_t now, bool immediate)
+    {
+        if (m_sensor == nullptr)
+        {
+            return false;
+        }
+
+        m_value = value;
+        ++m_num_updates;
+
+        if (!m_scheduled || immediate)
+        {
+            publish(now);
+            return true;
+        }
+
+        m_pending = true;
+        return false;
+    }
+
+    void PublishChannel::tick(uint32_t now)
+    {
+        if (m_last_publish_time < 0)
+        {
+            if (m_pending)
+            {
+                publish(now);
+            }
+
+            return;
+        }
+
+        // unsigned subtraction also handles the overflow of millis()
+        uint32_t elapsed = now - static_cast<uint32_t>(m_last_publish_time);
+
+        if (m_pending && (elapsed >= m_min_interval) && exceeds_deadband(m_value))
+        {
+            publish(now);
+        }
+        else if ((m_max_interval > 0) && (elapsed >= m_max_interval) && !std::isnan(m_value))
+        {
+            // refresh the state even if the change is within the deadband
+            publish(now);
+        }
+    }
+
+    void PublishChannel::dump_config(const char *name) const
+    {
+        if (is_scheduled())
+        {
+            ESP_LOGCONFIG(
+                TAG, "  %s publish policy: deadband %.2f%s, min interval %u ms, max interval %u ms",
+                name, m_deadband_percent ? m_deadband * 100 : m_deadband, m_deadband_percent ? " %" : "",
+                m_min_interval, m_max_interval);
+        }
+    }
+
+    bool PublishChannel::exceeds_deadband(float value) const
+    {
+        if (std::isnan(m_published_value))
+        {
+            return true;
+        }
+
+        float threshold = m_deadband_percent ? m_deadband * std::fabs(m_published_value) : m_deadband;
+
+        return std::fabs(value - m_published_value) > threshold;
+    }
+
+    void PublishChannel::publish(uint32_t now)
+    {
+        m_sensor->publish_state(m_value);
+
+        m_published_value = m_value;
+        m_last_publish_time = now;
+        m_pending = false;
+        ++m_num_publishes;
+    }
+
+    PublishScheduler& PublishScheduler::get_instance()
+    {
+        static PublishScheduler instance;
+        return instance;
+    }
+
+    PublishScheduler::PublishScheduler()
+        : m_channels()
+        , m_interval(std::numeric_limits<uint32_t>::max())
+        , m_owner(nullptr)
+        , m_last_tick_time(-1)
+    {
+    }
+
+    void PublishScheduler::request_interval(uint32_t interval)
+    {
+        if (interval < m_interval)
+        {
+            m_interval = interval;
+        }
+    }
+
+    void PublishScheduler::add_channel(PublishChannel *channel)
+    {
+        m_channels.push_back(channel);
+    }
+
+    void PublishScheduler::claim_tick(Component *owner)
+    {
+        if (m_owner == nullptr)
+        {
+            m_owner = owner;
+        }
+    }
+
+    void PublishScheduler::loop(Component *caller, uint32_t now)
+    {
+        if ((caller != m_owner) || m_channels.empty())
+        {
+            return;
+        }
+
+        if ((m_last_tick_time >= 0) && (now - static_cast<uint32_t>(m_last_tick_time) < m_interval))
+        {
+            return;
+        }
+
+        m_last_tick_time = now;
+
+        for (PublishChannel *channel : m_channels)
+        {
+            channel->tick(now);
+        }
+    }
+#endif
+}  // namespace esphome::ferraris
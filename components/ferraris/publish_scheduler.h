@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#pragma once
+
+#include "esphome/core/defines.h"
+#include "esphome/core/component.h"
+#ifdef USE_SENSOR
+#include "esphome/components/sensor/sensor.h"
+#endif
+
+#include <cstdint>
+#include <vector>
+
+
+namespace esphome::ferraris
+{
+#ifdef USE_SENSOR
+    /*
+     * Decides when a new state of a sensor is actually published. Without a
+     * policy, every update is published immediately. With a policy, updates are
+     * only stored and published on the next scheduler tick if they differ from
+     * the last published state by more than the deadband and the minimum
+     * interval has passed, or if the maximum interval has passed.
+     */
+    class PublishChannel
+    {
+    public:
+        PublishChannel();
+
+        void set_sensor(sensor::Sensor *sensor)
+        {
+            m_sensor = sensor;
+        }
+
+        void set_policy(float deadband, bool deadband_percent, uint32_t min_interval, uint32_t max_interval)
+        {
+            m_scheduled = true;
+            m_deadband = deadband;
+            m_deadband_percent = deadband_percent;
+            m_min_interval = min_interval;
+            m_max_interval = max_interval;
+        }
+
+        sensor::Sensor* get_sensor() const
+        {
+            return m_sensor;
+        }
+
+        bool is_scheduled() const
+        {
+            return m_scheduled && (m_sensor != nullptr);
+        }
+
+        uint32_t get_num_updates() const
+        {
+            return m_num_updates;
+        }
+
+        uint32_t get_num_publishes() const
+        {
+            return m_num_publishes;
+        }
+
+        // returns true if the value has been published immediately
+        bool update(float value, uint32_t now, bool immediate = false);
+        void tick(uint32_t now);
+        void dump_config(const char *name) const;
+
+    private:
+        bool exceeds_deadband(float value) const;
+        void publish(uint32_t now);
+
+        sensor::Sensor* m_sensor;
+        bool m_scheduled;
+        float m_deadband;
+        bool m_deadband_percent;
+        uint32_t m_min_interval;
+        uint32_t m_max_interval;
+
+        float m_value;
+        bool m_pending;
+        float m_published_value;
+        int64_t m_last_publish_time;
+
+        uint32_t m_num_updates;
+        uint32_t m_num_publishes;
+    };
+
+    /*
+     * Shared tick for the scheduled publish channels of all Ferraris meters of
+     * a node, so that pending states are published in one batch. The tick is
+     * driven from the loop of the first meter claiming it, using the smallest
+     * interval requested by any meter.
+     */
+    class PublishScheduler
+    {
+    public:
+        static PublishScheduler& get_instance();
+
+        void request_interval(uint32_t interval);
+        void add_channel(PublishChannel *channel);
+        void claim_tick(Component *owner);
+        void loop(Component *caller, uint32_t now);
+
+        uint32_t get_interval() const
+        {
+            return m_interval;
+        }
+
+    private:
+        PublishScheduler();
+
+        std::vector<PublishChannel*> m_channels;
+        uint32_t m_interval;
+        Component* m_owner;
+        int64_t m_last_tick_time;
+    };
+#endif
+}  // namespace esphome::ferraris
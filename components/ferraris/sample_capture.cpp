@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include "sample_capture.h"
+#include "esphome/core/helpers.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+
+namespace esphome::ferraris
+{
+    SampleCapture::SampleCapture()
+        : m_records(nullptr)
+        , m_capacity(0)
+        , m_head(0)
+        , m_count(0)
+        , m_active(false)
+        , m_wrap(false)
+        , m_duration(0)
+        , m_capture_start(0)
+        , m_start_time(0)
+        , m_last_time(0)
+    {
+    }
+
+    bool SampleCapture::allocate(uint32_t capacity)
+    {
+        // prefers PSRAM if available and falls back to internal RAM
+        RAMAllocator<CaptureRecord> allocator(RAMAllocator<CaptureRecord>::ALLOW_FAILURE);
+
+        m_records = allocator.allocate(capacity);
+        m_capacity = (m_records != nullptr) ? capacity : 0;
+
+        return m_records != nullptr;
+    }
+
+    void SampleCapture::start(uint32_t duration, uint32_t now)
+    {
+        m_head = 0;
+        m_count = 0;
+        m_active = (m_records != nullptr);
+        m_wrap = (duration > 0);
+        m_duration = duration;
+        m_capture_start = now;
+        m_start_time = now;
+        m_last_time = now;
+    }
+
+    void SampleCapture::stop()
+    {
+        m_active = false;
+    }
+
+    bool SampleCapture::add(float value, uint8_t flags, uint32_t now)
+    {
+        if (!m_active)
+        {
+            return false;
+        }
+
+        if (m_wrap && (now - m_capture_start >= m_duration))
+        {
+            m_active = false;
+            return false;
+        }
+
+        CaptureRecord record;
+        record.delta_time = (m_count == 0)
+                                ? 0
+                                : static_cast<uint16_t>(std::min<uint32_t>(now - m_last_time, std::numeric_limits<uint16_t>::max()));
+        record.flags = flags;
+        record.reserved = 0;
+        record.value = value;
+
+        if (m_count == 0)
+        {
+            m_start_time = now;
+        }
+
+        m_last_time = now;
+
+        if (m_count < m_capacity)
+        {
+            m_records[(m_head + m_count) % m_capacity] = record;
+            ++m_count;
+        }
+        else
+        {
+            // overwrite the oldest record, the next one becomes the start of the capture
+            m_records[m_head] = record;
+            m_head = (m_head + 1) % m_capacity;
+            m_start_time += m_records[m_head].delta_time;
+        }
+
+        if (!m_wrap && (m_count == m_capacity))
+        {
+            m_active = false;
+            return false;
+        }
+
+        return true;
+    }
+
+    const CaptureRecord& SampleCapture::get_record(uint32_t index) const
+    {
+        return m_records[(m_head + index) % m_capacity];
+    }
+
+    size_t SampleCapture::read(const CaptureHeader &header, uint32_t offset, uint8_t *buffer, size_t length) const
+    {
+        size_t num_read = 0;
+
+        while ((num_read < length) && (offset < get_serialized_size()))
+        {
+            const uint8_t *source = nullptr;
+            size_t available = 0;
+
+            if (offset < sizeof(CaptureHeader))
+            {
+                source = reinterpret_cast<const uint8_t*>(&header) + offset;
+                available = sizeof(CaptureHeader) - offset;
+            }
+            else
+            {
+                uint32_t record_offset = offset - sizeof(CaptureHeader);
+                uint32_t byte_offset = record_offset % sizeof(CaptureRecord);
+
+                source = reinterpret_cast<const uint8_t*>(&get_record(record_offset / sizeof(CaptureRecord))) + byte_offset;
+                available = sizeof(CaptureRecord) - byte_offset;
+            }
+
+            size_t num_bytes = std::min(available, length - num_read);
+            std::memcpy(buffer + num_read, source, num_bytes);
+
+            num_read += num_bytes;
+            offset += num_bytes;
+        }
+
+        return num_read;
+    }
+}  // namespace esphome::ferraris
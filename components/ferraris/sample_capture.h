@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace esphome::ferraris
+{
+    /*
+     * Binary capture format (little endian), version 2:
+     *
+     *   header:  char[4] magic "FRCP", uint8 version, uint8[3] reserved,
+     *            uint32 record count, uint32 start time (ms), float threshold,
+     *            float off tolerance, float on tolerance, uint32 debounce threshold,
+     *            uint32 rotations per kWh, uint32 marks per rotation
+     *   records: uint16 time since previous record (ms, meaningless for the
+     *            first record), uint8 flags, uint8 reserved, float raw analog value
+     */
+    static constexpr const uint8_t CAPTURE_FORMAT_VERSION = 2;
+
+    static constexpr const uint8_t CAPTURE_FLAG_STATE       = 0x01;  // derived state after the sample
+    static constexpr const uint8_t CAPTURE_FLAG_ROTATION    = 0x02;  // rotation counted at this sample
+    static constexpr const uint8_t CAPTURE_FLAG_DEBOUNCED   = 0x04;  // edge rejected by debouncing
+    static constexpr const uint8_t CAPTURE_FLAG_CALIBRATION = 0x08;  // calibration mode active
+
+    struct __attribute__((packed)) CaptureHeader
+    {
+        char magic[4];
+        uint8_t version;
+        uint8_t reserved[3];
+        uint32_t count;
+        uint32_t start_time;
+        float threshold;
+        float off_tolerance;
+        float on_tolerance;
+        uint32_t debounce_threshold;
+        uint32_t rotations_per_kwh;
+        uint32_t marks_per_rotation;
+    };
+
+    struct __attribute__((packed)) CaptureRecord
+    {
+        uint16_t delta_time;
+        uint8_t flags;
+        uint8_t reserved;
+        float value;
+    };
+
+    /*
+     * Preallocated ring buffer of raw analog samples together with the states
+     * derived from them. A running capture overwrites the oldest records once
+     * the buffer is full, unless it has been started without a duration, in
+     * which case it stops when the buffer is full.
+     */
+    class SampleCapture
+    {
+    public:
+        SampleCapture();
+
+        bool allocate(uint32_t capacity);
+        void start(uint32_t duration, uint32_t now);
+        void stop();
+        // returns false when the capture has ended with this sample
+        bool add(float value, uint8_t flags, uint32_t now);
+
+        // index 0 is the oldest record
+        const CaptureRecord& get_record(uint32_t index) const;
+        // reads from the serialized capture (header followed by the records), returns number of bytes read
+        size_t read(const CaptureHeader &header, uint32_t offset, uint8_t *buffer, size_t length) const;
+
+        uint32_t get_serialized_size() const
+        {
+            return sizeof(CaptureHeader) + m_count * sizeof(CaptureRecord);
+        }
+
+        bool is_allocated() const
+        {
+            return m_records != nullptr;
+        }
+
+        bool is_active() const
+        {
+            return m_active;
+        }
+
+        uint32_t get_capacity() const
+        {
+            return m_capacity;
+        }
+
+        uint32_t get_count() const
+        {
+            return m_count;
+        }
+
+        uint32_t get_start_time() const
+        {
+            return m_start_time;
+        }
+
+    private:
+        CaptureRecord* m_records;
+        uint32_t m_capacity;
+        uint32_t m_head;
+        uint32_t m_count;
+
+        bool m_active;
+        bool m_wrap;
+        uint32_t m_duration;
+        uint32_t m_capture_start;
+        uint32_t m_start_time;
+        uint32_t m_last_time;
+    };
+}  // namespace esphome::ferraris
@@ -23,53 +23,232 @@
 
 import esphome.codegen           as cg
 import esphome.config_validation as cv
+import esphome.final_validate    as fv
 
 from esphome.components import sensor
 from esphome.const      import (
     STATE_CLASS_MEASUREMENT,
     STATE_CLASS_TOTAL_INCREASING,
+    DEVICE_CLASS_DURATION,
     DEVICE_CLASS_POWER,
     DEVICE_CLASS_ENERGY,
     ENTITY_CATEGORY_DIAGNOSTIC,
+    UNIT_MILLISECOND,
+    UNIT_PERCENT,
     UNIT_WATT,
     UNIT_WATT_HOURS
 )
 from .                  import (
     FerrarisMeter,
-    CONF_FERRARIS_ID
+    CONF_FERRARIS_ID,
+    CONF_ENERGY_REGISTERS,
+    CONF_TARIFFS,
+    MAX_TARIFFS
 )
 
 
 CODEOWNERS = ["@jensrossbach"]
 
-CONF_POWER_CONSUMPTION     = "power_consumption"
-CONF_ENERGY_METER          = "energy_meter"
-CONF_ANALOG_VALUE_SPECTRUM = "analog_value_spectrum"
+CONF_POWER_CONSUMPTION          = "power_consumption"
+CONF_ENERGY_METER               = "energy_meter"
+CONF_ANALOG_VALUE_SPECTRUM      = "analog_value_spectrum"
+CONF_ROTATION_PERIOD_ESTIMATE   = "rotation_period_estimate"
+CONF_ROTATION_PERIOD_CONFIDENCE = "rotation_period_confidence"
+CONF_ROTATION_COUNT_DEVIATION   = "rotation_count_deviation"
+CONF_ANALOG_LEVEL_SEPARATION    = "analog_level_separation"
+CONF_ANALOG_ON_NOISE            = "analog_on_noise"
+CONF_ANALOG_OFF_NOISE           = "analog_off_noise"
+CONF_ANALOG_CROSSING_MARGIN     = "analog_crossing_margin"
+CONF_ANALOG_HYSTERESIS_MARGIN   = "analog_hysteresis_margin"
+CONF_ANALOG_THRESHOLD_FLAPS     = "analog_threshold_flaps"
+CONF_PUBLISH_REDUCTION          = "publish_reduction"
+CONF_TARIFF_ENERGY              = "tariff_energy"
+CONF_ACTIVE_TARIFF              = "active_tariff"
+CONF_PREVIOUS_HOUR_ENERGY       = "previous_hour_energy"
+CONF_MAX_POWER                  = "max_power"
+CONF_TIMING_ERROR               = "timing_error"
+CONF_DEADBAND                   = "deadband"
+CONF_MIN_PUBLISH_INTERVAL       = "min_publish_interval"
+CONF_MAX_PUBLISH_INTERVAL       = "max_publish_interval"
+
+
+def is_relative_deadband(value):
+    return isinstance(value, str) and value.strip().endswith("%")
+
+def validate_deadband(value):
+    # relative deadbands keep their percent notation, absolute ones are parsed
+    if is_relative_deadband(value):
+        cv.percentage(value)
+        return value.strip()
+    return cv.positive_float(value)
+
+def ensure_publish_intervals(value):
+    if CONF_MIN_PUBLISH_INTERVAL in value and CONF_MAX_PUBLISH_INTERVAL in value:
+        if value[CONF_MAX_PUBLISH_INTERVAL] < value[CONF_MIN_PUBLISH_INTERVAL]:
+            raise cv.Invalid(f"'{CONF_MAX_PUBLISH_INTERVAL}' must not be less than '{CONF_MIN_PUBLISH_INTERVAL}'.")
+    return value
+
+def final_validate_energy_registers(config):
+    options = [CONF_TARIFF_ENERGY, CONF_ACTIVE_TARIFF, CONF_PREVIOUS_HOUR_ENERGY]
+    if not any(option in config for option in options):
+        return config
+
+    full_config = fv.full_config.get()
+    meter_path = full_config.get_path_for_id(config[CONF_FERRARIS_ID])[:-1]
+    meter_config = full_config.get_config_for_path(meter_path)
+
+    if CONF_ENERGY_REGISTERS not in meter_config:
+        for option in options:
+            if option in config:
+                raise cv.Invalid(f"'{option}' requires '{CONF_ENERGY_REGISTERS}' to be configured for the Ferraris component.")
+
+    num_tariffs = meter_config[CONF_ENERGY_REGISTERS][CONF_TARIFFS]
+    if len(config.get(CONF_TARIFF_ENERGY, [])) > num_tariffs:
+        raise cv.Invalid(f"'{CONF_TARIFF_ENERGY}' must not contain more sensors than the {num_tariffs} configured '{CONF_TARIFFS}'.")
+
+    return config
+
+def has_publish_policy(config):
+    return any(key in config for key in [CONF_DEADBAND, CONF_MIN_PUBLISH_INTERVAL, CONF_MAX_PUBLISH_INTERVAL])
+
+def publish_policy_args(config):
+    deadband = config.get(CONF_DEADBAND, 0.0)
+    deadband_percent = is_relative_deadband(deadband)
+    return [
+        cv.percentage(deadband) if deadband_percent else deadband,
+        deadband_percent,
+        config.get(CONF_MIN_PUBLISH_INTERVAL, 0),
+        config.get(CONF_MAX_PUBLISH_INTERVAL, 0)]
+
+
+PUBLISH_POLICY_SCHEMA = cv.Schema({
+    cv.Optional(CONF_DEADBAND): validate_deadband,
+    cv.Optional(CONF_MIN_PUBLISH_INTERVAL): cv.positive_time_period_milliseconds,
+    cv.Optional(CONF_MAX_PUBLISH_INTERVAL): cv.positive_time_period_milliseconds
+})
 
 CONFIG_SCHEMA = cv.Schema(
 {
     cv.GenerateID(CONF_FERRARIS_ID): cv.use_id(FerrarisMeter),
-    cv.Optional(CONF_POWER_CONSUMPTION): sensor.sensor_schema(
+    cv.Optional(CONF_POWER_CONSUMPTION): cv.All(sensor.sensor_schema(
         icon="mdi:lightning-bolt",
         device_class=DEVICE_CLASS_POWER,
         state_class=STATE_CLASS_MEASUREMENT,
         unit_of_measurement=UNIT_WATT,
         accuracy_decimals=1
-    ),
-    cv.Optional(CONF_ENERGY_METER): sensor.sensor_schema(
+    ).extend(PUBLISH_POLICY_SCHEMA), ensure_publish_intervals),
+    cv.Optional(CONF_ENERGY_METER): cv.All(sensor.sensor_schema(
         icon="mdi:transmission-tower",
         device_class=DEVICE_CLASS_ENERGY,
         state_class=STATE_CLASS_TOTAL_INCREASING,
         unit_of_measurement=UNIT_WATT_HOURS,
         accuracy_decimals=1
-    ),
+    ).extend(PUBLISH_POLICY_SCHEMA), ensure_publish_intervals),
     cv.Optional(CONF_ANALOG_VALUE_SPECTRUM): sensor.sensor_schema(
         icon="mdi:arrow-expand-vertical",
         accuracy_decimals=0,
         entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+    ),
+    cv.Optional(CONF_ROTATION_PERIOD_ESTIMATE): sensor.sensor_schema(
+        icon="mdi:timer-sync-outline",
+        device_class=DEVICE_CLASS_DURATION,
+        state_class=STATE_CLASS_MEASUREMENT,
+        unit_of_measurement=UNIT_MILLISECOND,
+        accuracy_decimals=0,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+    ),
+    cv.Optional(CONF_ROTATION_PERIOD_CONFIDENCE): sensor.sensor_schema(
+        icon="mdi:check-decagram-outline",
+        state_class=STATE_CLASS_MEASUREMENT,
+        unit_of_measurement=UNIT_PERCENT,
+        accuracy_decimals=0,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+    ),
+    cv.Optional(CONF_ROTATION_COUNT_DEVIATION): sensor.sensor_schema(
+        icon="mdi:plus-minus-variant",
+        state_class=STATE_CLASS_MEASUREMENT,
+        accuracy_decimals=1,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+    ),
+    cv.Optional(CONF_ANALOG_LEVEL_SEPARATION): sensor.sensor_schema(
+        icon="mdi:arrow-split-horizontal",
+        state_class=STATE_CLASS_MEASUREMENT,
+        accuracy_decimals=1,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+    ),
+    cv.Optional(CONF_ANALOG_ON_NOISE): sensor.sensor_schema(
+        icon="mdi:waveform",
+        state_class=STATE_CLASS_MEASUREMENT,
+        accuracy_decimals=2,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+    ),
+    cv.Optional(CONF_ANALOG_OFF_NOISE): sensor.sensor_schema(
+        icon="mdi:waveform",
+        state_class=STATE_CLASS_MEASUREMENT,
+        accuracy_decimals=2,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+    ),
+    cv.Optional(CONF_ANALOG_CROSSING_MARGIN): sensor.sensor_schema(
+        icon="mdi:format-vertical-align-center",
+        state_class=STATE_CLASS_MEASUREMENT,
+        accuracy_decimals=1,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+    ),
+    cv.Optional(CONF_ANALOG_HYSTERESIS_MARGIN): sensor.sensor_schema(
+        icon="mdi:format-vertical-align-center",
+        state_class=STATE_CLASS_MEASUREMENT,
+        accuracy_decimals=1,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+    ),
+    cv.Optional(CONF_ANALOG_THRESHOLD_FLAPS): sensor.sensor_schema(
+        icon="mdi:swap-vertical",
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        accuracy_decimals=0,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+    ),
+    cv.Optional(CONF_TARIFF_ENERGY): cv.All(cv.ensure_list(sensor.sensor_schema(
+        icon="mdi:transmission-tower",
+        device_class=DEVICE_CLASS_ENERGY,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        unit_of_measurement=UNIT_WATT_HOURS,
+        accuracy_decimals=1
+    )), cv.Length(min = 1, max = MAX_TARIFFS)),
+    cv.Optional(CONF_ACTIVE_TARIFF): sensor.sensor_schema(
+        icon="mdi:cash-clock",
+        accuracy_decimals=0
+    ),
+    cv.Optional(CONF_PREVIOUS_HOUR_ENERGY): sensor.sensor_schema(
+        icon="mdi:clock-time-four-outline",
+        device_class=DEVICE_CLASS_ENERGY,
+        unit_of_measurement=UNIT_WATT_HOURS,
+        accuracy_decimals=1
+    ),
+    cv.Optional(CONF_PUBLISH_REDUCTION): sensor.sensor_schema(
+        icon="mdi:message-minus-outline",
+        state_class=STATE_CLASS_MEASUREMENT,
+        unit_of_measurement=UNIT_PERCENT,
+        accuracy_decimals=0,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+    ),
+    cv.Optional(CONF_MAX_POWER): sensor.sensor_schema(
+        icon="mdi:gauge-full",
+        device_class=DEVICE_CLASS_POWER,
+        state_class=STATE_CLASS_MEASUREMENT,
+        unit_of_measurement=UNIT_WATT,
+        accuracy_decimals=0,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+    ),
+    cv.Optional(CONF_TIMING_ERROR): sensor.sensor_schema(
+        icon="mdi:timer-alert-outline",
+        state_class=STATE_CLASS_MEASUREMENT,
+        unit_of_measurement=UNIT_PERCENT,
+        accuracy_decimals=2,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC
     )
 })
 
+FINAL_VALIDATE_SCHEMA = final_validate_energy_registers
+
 
 async def to_code(config):
     cmp = await cg.get_variable(config[CONF_FERRARIS_ID])
@@ -78,10 +257,77 @@ async def to_code(config):
         sens = await sensor.new_sensor(config[CONF_POWER_CONSUMPTION])
         cg.add(cmp.set_power_consumption_sensor(sens))
 
+        if has_publish_policy(config[CONF_POWER_CONSUMPTION]):
+            cg.add(cmp.set_power_consumption_publish_policy(*publish_policy_args(config[CONF_POWER_CONSUMPTION])))
+
     if CONF_ENERGY_METER in config:
         sens = await sensor.new_sensor(config[CONF_ENERGY_METER])
         cg.add(cmp.set_energy_meter_sensor(sens))
 
+        if has_publish_policy(config[CONF_ENERGY_METER]):
+            cg.add(cmp.set_energy_meter_publish_policy(*publish_policy_args(config[CONF_ENERGY_METER])))
+
     if CONF_ANALOG_VALUE_SPECTRUM in config:
         sens = await sensor.new_sensor(config[CONF_ANALOG_VALUE_SPECTRUM])
         cg.add(cmp.set_analog_value_spectrum_sensor(sens))
+
+    if CONF_ROTATION_PERIOD_ESTIMATE in config:
+        sens = await sensor.new_sensor(config[CONF_ROTATION_PERIOD_ESTIMATE])
+        cg.add(cmp.set_rotation_period_estimate_sensor(sens))
+
+    if CONF_ROTATION_PERIOD_CONFIDENCE in config:
+        sens = await sensor.new_sensor(config[CONF_ROTATION_PERIOD_CONFIDENCE])
+        cg.add(cmp.set_rotation_period_confidence_sensor(sens))
+
+    if CONF_ROTATION_COUNT_DEVIATION in config:
+        sens = await sensor.new_sensor(config[CONF_ROTATION_COUNT_DEVIATION])
+        cg.add(cmp.set_rotation_count_deviation_sensor(sens))
+
+    if CONF_ANALOG_LEVEL_SEPARATION in config:
+        sens = await sensor.new_sensor(config[CONF_ANALOG_LEVEL_SEPARATION])
+        cg.add(cmp.set_analog_level_separation_sensor(sens))
+
+    if CONF_ANALOG_ON_NOISE in config:
+        sens = await sensor.new_sensor(config[CONF_ANALOG_ON_NOISE])
+        cg.add(cmp.set_analog_on_noise_sensor(sens))
+
+    if CONF_ANALOG_OFF_NOISE in config:
+        sens = await sensor.new_sensor(config[CONF_ANALOG_OFF_NOISE])
+        cg.add(cmp.set_analog_off_noise_sensor(sens))
+
+    if CONF_ANALOG_CROSSING_MARGIN in config:
+        sens = await sensor.new_sensor(config[CONF_ANALOG_CROSSING_MARGIN])
+        cg.add(cmp.set_analog_crossing_margin_sensor(sens))
+
+    if CONF_ANALOG_HYSTERESIS_MARGIN in config:
+        sens = await sensor.new_sensor(config[CONF_ANALOG_HYSTERESIS_MARGIN])
+        cg.add(cmp.set_analog_hysteresis_margin_sensor(sens))
+
+    if CONF_ANALOG_THRESHOLD_FLAPS in config:
+        sens = await sensor.new_sensor(config[CONF_ANALOG_THRESHOLD_FLAPS])
+        cg.add(cmp.set_analog_threshold_flaps_sensor(sens))
+
+    if CONF_PUBLISH_REDUCTION in config:
+        sens = await sensor.new_sensor(config[CONF_PUBLISH_REDUCTION])
+        cg.add(cmp.set_publish_reduction_sensor(sens))
+
+    if CONF_TARIFF_ENERGY in config:
+        for tariff, sens_conf in enumerate(config[CONF_TARIFF_ENERGY], start = 1):
+            sens = await sensor.new_sensor(sens_conf)
+            cg.add(cmp.set_tariff_energy_sensor(tariff, sens))
+
+    if CONF_ACTIVE_TARIFF in config:
+        sens = await sensor.new_sensor(config[CONF_ACTIVE_TARIFF])
+        cg.add(cmp.set_active_tariff_sensor(sens))
+
+    if CONF_PREVIOUS_HOUR_ENERGY in config:
+        sens = await sensor.new_sensor(config[CONF_PREVIOUS_HOUR_ENERGY])
+        cg.add(cmp.set_previous_hour_energy_sensor(sens))
+
+    if CONF_MAX_POWER in config:
+        sens = await sensor.new_sensor(config[CONF_MAX_POWER])
+        cg.add(cmp.set_max_power_sensor(sens))
+
+    if CONF_TIMING_ERROR in config:
+        sens = await sensor.new_sensor(config[CONF_TIMING_ERROR])
+        cg.add(cmp.set_timing_error_sensor(sens))
@@ -0,0 +1,86 @@
+# Copyright (c) 2024-2025 Jens-Uwe Rossbach
+#
+# This code is licensed under the MIT License.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+
+import esphome.codegen           as cg
+import esphome.config_validation as cv
+
+from esphome.components          import sensor
+from esphome.components.ferraris import FerrarisMeter
+from esphome.const               import (
+    CONF_ID,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    DEVICE_CLASS_POWER,
+    DEVICE_CLASS_ENERGY,
+    UNIT_WATT,
+    UNIT_WATT_HOURS
+)
+
+
+CODEOWNERS = ["@jensrossbach"]
+DEPENDENCIES = ["ferraris"]
+AUTO_LOAD = ["sensor"]
+MULTI_CONF = True
+
+CONF_METERS            = "meters"
+CONF_POWER_CONSUMPTION = "power_consumption"
+CONF_ENERGY_METER      = "energy_meter"
+
+ferraris_ns = cg.esphome_ns.namespace("ferraris")
+FerrarisAggregate = ferraris_ns.class_("FerrarisAggregate", cg.PollingComponent)
+
+CONFIG_SCHEMA = cv.Schema({
+        cv.GenerateID(): cv.declare_id(FerrarisAggregate),
+        cv.Required(CONF_METERS): cv.All(cv.ensure_list(cv.use_id(FerrarisMeter)), cv.Length(min = 2)),
+        cv.Optional(CONF_POWER_CONSUMPTION): sensor.sensor_schema(
+            icon="mdi:lightning-bolt",
+            device_class=DEVICE_CLASS_POWER,
+            state_class=STATE_CLASS_MEASUREMENT,
+            unit_of_measurement=UNIT_WATT,
+            accuracy_decimals=1
+        ),
+        cv.Optional(CONF_ENERGY_METER): sensor.sensor_schema(
+            icon="mdi:transmission-tower",
+            device_class=DEVICE_CLASS_ENERGY,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            unit_of_measurement=UNIT_WATT_HOURS,
+            accuracy_decimals=1
+        )
+    }).extend(cv.polling_component_schema("10s"))
+
+
+async def to_code(config):
+    cmp = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(cmp, config)
+
+    for meter_id in config[CONF_METERS]:
+        meter = await cg.get_variable(meter_id)
+        cg.add(cmp.add_meter(meter))
+
+    if CONF_POWER_CONSUMPTION in config:
+        sens = await sensor.new_sensor(config[CONF_POWER_CONSUMPTION])
+        cg.add(cmp.set_power_consumption_sensor(sens))
+
+    if CONF_ENERGY_METER in config:
+        sens = await sensor.new_sensor(config[CONF_ENERGY_METER])
+        cg.add(cmp.set_energy_meter_sensor(sens))
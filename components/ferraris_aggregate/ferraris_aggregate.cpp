@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include "ferraris_aggregate.h"
+#include "esphome/core/log.h"
+#include "esphome/core/hal.h"
+
+
+namespace esphome::ferraris
+{
+    static constexpr const char *const TAG = "ferraris_aggregate";
+
+    FerrarisAggregate::FerrarisAggregate()
+        : PollingComponent()
+        , m_meters()
+        , m_power_consumption_sensor(nullptr)
+        , m_energy_meter_sensor(nullptr)
+    {
+    }
+
+    void FerrarisAggregate::update()
+    {
+        uint32_t now = millis();
+        float power = 0.0f;
+        float energy = 0.0f;
+        bool energy_valid = true;
+
+        for (FerrarisMeter *meter : m_meters)
+        {
+            power += meter->get_power_estimate(now);
+            energy += meter->get_energy();
+            energy_valid = energy_valid && meter->has_energy_baseline();
+        }
+
+        if (m_power_consumption_sensor != nullptr)
+        {
+            m_power_consumption_sensor->publish_state(power);
+            ESP_LOGD(TAG, "Published aggregated power consumption sensor state: %.2f W", power);
+        }
+
+        if (m_energy_meter_sensor != nullptr)
+        {
+            if (energy_valid)
+            {
+                m_energy_meter_sensor->publish_state(energy);
+                ESP_LOGD(TAG, "Published aggregated energy meter sensor state: %.2f Wh", energy);
+            }
+            else
+            {
+                // avoid publishing a sum which is not yet based on all start values
+                ESP_LOGD(TAG, "Deferring aggregated energy meter sensor state until all start values are received");
+            }
+        }
+    }
+
+    void FerrarisAggregate::dump_config()
+    {
+        ESP_LOGCONFIG(TAG, "Ferraris Aggregate");
+        ESP_LOGCONFIG(TAG, "  Number of meters: %u", static_cast<uint32_t>(m_meters.size()));
+        LOG_UPDATE_INTERVAL(this);
+        LOG_SENSOR("", "Power consumption sensor", m_power_consumption_sensor);
+        LOG_SENSOR("", "Energy meter sensor", m_energy_meter_sensor);
+    }
+}  // namespace esphome::ferraris
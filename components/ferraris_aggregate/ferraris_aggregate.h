@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/components/ferraris/ferraris_meter.h"
+
+#include <vector>
+
+
+namespace esphome::ferraris
+{
+    /*
+     * Virtual meter summing up the power and energy of multiple Ferraris meters.
+     * All meters are sampled at the same point in time on each update, so the
+     * aggregated values do not suffer from unsynchronized per-meter publishes.
+     */
+    class FerrarisAggregate : public PollingComponent
+    {
+    public:
+        FerrarisAggregate();
+        virtual ~FerrarisAggregate() = default;
+
+        void update() override;
+        void dump_config() override;
+
+        void add_meter(FerrarisMeter *meter)
+        {
+            m_meters.push_back(meter);
+        }
+
+        void set_power_consumption_sensor(sensor::Sensor *sensor)
+        {
+            m_power_consumption_sensor = sensor;
+        }
+
+        void set_energy_meter_sensor(sensor::Sensor *sensor)
+        {
+            m_energy_meter_sensor = sensor;
+        }
+
+    protected:
+        std::vector<FerrarisMeter*> m_meters;
+        sensor::Sensor* m_power_consumption_sensor;
+        sensor::Sensor* m_energy_meter_sensor;
+    };
+}  // namespace esphome::ferraris
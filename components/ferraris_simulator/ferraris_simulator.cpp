@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include "ferraris_simulator.h"
+#include "esphome/core/log.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+
+#include <cmath>
+
+
+namespace esphome::ferraris
+{
+    static constexpr const double WATTS_PER_KW = 1000;
+    static constexpr const double MS_PER_HOUR  = 60 * 60 * 1000;
+
+    // fraction of the marker width around each edge in which bouncing can occur
+    static constexpr const double BOUNCE_ZONE  = 0.25;
+
+    static constexpr const char *const TAG = "ferraris_simulator";
+
+    FerrarisSimulator::FerrarisSimulator(uint32_t rpkwh)
+        : sensor::Sensor()
+        , PollingComponent()
+        , m_rotation_counter_sensor(nullptr)
+        , m_energy_meter_sensor(nullptr)
+        , m_power_consumption_sensor(nullptr)
+        , m_rotations_per_kwh(rpkwh)
+        , m_base_power(500.0f)
+        , m_power_variation(0.0f)
+        , m_load_change_interval(0)
+        , m_off_level(20.0f)
+        , m_on_level(80.0f)
+        , m_marker_width(0.05f)
+        , m_noise(0.0f)
+        , m_drift(0.0f)
+        , m_drift_period(0)
+        , m_ambient_step(0.0f)
+        , m_ambient_step_interval(0)
+        , m_bounce_probability(0.0f)
+        , m_digital(false)
+        , m_power(m_base_power)
+        , m_ambient_offset(0.0f)
+        , m_phase(0.0)
+        , m_energy(0.0)
+        , m_rotation_counter(0)
+        , m_start_time(0)
+        , m_last_time(-1)
+    {
+    }
+
+    void FerrarisSimulator::setup()
+    {
+        ESP_LOGCONFIG(TAG, "Setting up Ferraris Simulator...");
+
+        m_start_time = millis();
+
+        if ((m_power_variation > 0.0f) && (m_load_change_interval > 0))
+        {
+            set_interval("load_change", m_load_change_interval, [this]()
+            {
+                set_power(m_base_power + (2 * random_float() - 1) * m_power_variation);
+            });
+        }
+
+        if ((m_ambient_step > 0.0f) && (m_ambient_step_interval > 0))
+        {
+            set_interval("ambient_step", m_ambient_step_interval, [this]()
+            {
+                m_ambient_offset = (2 * random_float() - 1) * m_ambient_step;
+                ESP_LOGD(TAG, "Ambient light offset:  %.1f", m_ambient_offset);
+            });
+        }
+
+        publish_ground_truth();
+    }
+
+    void FerrarisSimulator::update()
+    {
+        uint32_t now = millis();
+
+        if (m_last_time >= 0)
+        {
+            uint32_t elapsed = now - static_cast<uint32_t>(m_last_time);
+            double energy = m_power * elapsed / MS_PER_HOUR;
+            bool rotated = false;
+
+            m_energy += energy;
+            m_phase += energy / WATTS_PER_KW * m_rotations_per_kwh;
+
+            while (m_phase >= 1.0)
+            {
+                m_phase -= 1.0;
+                ++m_rotation_counter;
+                rotated = true;
+            }
+
+            if (rotated)
+            {
+                publish_ground_truth();
+            }
+        }
+
+        m_last_time = now;
+
+        bool marker = is_marker_visible();
+        float value = 0.0f;
+
+        if (m_digital)
+        {
+            value = marker ? 1.0f : 0.0f;
+        }
+        else
+        {
+            value = (marker ? m_on_level : m_off_level) + m_ambient_offset;
+
+            if ((m_drift != 0.0f) && (m_drift_period > 0))
+            {
+                uint32_t drift_time = (now - m_start_time) % m_drift_period;
+                value += m_drift * std::sin(2 * M_PI * drift_time / m_drift_period);
+            }
+
+            if (m_noise > 0.0f)
+            {
+                value += m_noise * random_gaussian();
+            }
+        }
+
+        publish_state(value);
+    }
+
+    void FerrarisSimulator::dump_config()
+    {
+        LOG_SENSOR("", "Ferraris Simulator", this);
+        LOG_UPDATE_INTERVAL(this);
+        ESP_LOGCONFIG(TAG, "  Rotations per kWh: %u", m_rotations_per_kwh);
+        ESP_LOGCONFIG(TAG, "  Power: %.1f W (variation %.1f W every %u ms)", m_base_power, m_power_variation, m_load_change_interval);
+        ESP_LOGCONFIG(TAG, "  Mode: %s", m_digital ? "digital" : "analog");
+        if (!m_digital)
+        {
+            ESP_LOGCONFIG(TAG, "  Levels: OFF %.1f  ON %.1f", m_off_level, m_on_level);
+            ESP_LOGCONFIG(TAG, "  Noise: %.2f", m_noise);
+            ESP_LOGCONFIG(TAG, "  Drift: %.1f (period %u ms)", m_drift, m_drift_period);
+            ESP_LOGCONFIG(TAG, "  Ambient step: %.1f (every %u ms)", m_ambient_step, m_ambient_step_interval);
+        }
+        ESP_LOGCONFIG(TAG, "  Marker width: %.1f %%", m_marker_width * 100);
+        ESP_LOGCONFIG(TAG, "  Bounce probability: %.1f %%", m_bounce_probability * 100);
+        LOG_SENSOR("  ", "Rotation counter sensor", m_rotation_counter_sensor);
+        LOG_SENSOR("  ", "Energy meter sensor", m_energy_meter_sensor);
+        LOG_SENSOR("  ", "Power consumption sensor", m_power_consumption_sensor);
+    }
+
+    void FerrarisSimulator::set_power(float power)
+    {
+        m_power = (power > 0.0f) ? power : 0.0f;
+        ESP_LOGD(TAG, "Simulated power consumption:  %.1f W", m_power);
+
+        if (m_power_consumption_sensor != nullptr)
+        {
+            m_power_consumption_sensor->publish_state(m_power);
+        }
+    }
+
+    bool FerrarisSimulator::is_marker_visible() const
+    {
+        bool visible = (m_phase < m_marker_width);
+
+        if (m_bounce_probability > 0.0f)
+        {
+            double zone = m_marker_width * BOUNCE_ZONE;
+            bool near_edge = (m_phase < zone) ||
+                             (m_phase > 1.0 - zone) ||
+                             (std::fabs(m_phase - m_marker_width) < zone);
+
+            if (near_edge && (random_float() < m_bounce_probability))
+            {
+                visible = !visible;
+            }
+        }
+
+        return visible;
+    }
+
+    void FerrarisSimulator::publish_ground_truth()
+    {
+        if (m_rotation_counter_sensor != nullptr)
+        {
+            m_rotation_counter_sensor->publish_state(m_rotation_counter);
+        }
+
+        if (m_energy_meter_sensor != nullptr)
+        {
+            m_energy_meter_sensor->publish_state(m_energy);
+        }
+
+        if (m_power_consumption_sensor != nullptr)
+        {
+            m_power_consumption_sensor->publish_state(m_power);
+        }
+    }
+
+    float FerrarisSimulator::random_gaussian()
+    {
+        // Box-Muller transform
+        float u1 = random_float();
+        float u2 = random_float();
+
+        if (u1 < 1e-7f)
+        {
+            u1 = 1e-7f;
+        }
+
+        return std::sqrt(-2 * std::log(u1)) * std::cos(2 * M_PI * u2);
+    }
+}  // namespace esphome::ferraris
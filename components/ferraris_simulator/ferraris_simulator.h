@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/components/sensor/sensor.h"
+
+
+namespace esphome::ferraris
+{
+    /*
+     * Generates a synthetic signal of an infrared sensor (e.g. TCRT5000) observing
+     * the turntable of a Ferraris electricity meter, including noise, slow drift,
+     * bouncing at the marker edges, ambient light steps and load changes. The
+     * ground truth (rotations, energy and power) is exposed via optional sensors.
+     */
+    class FerrarisSimulator : public sensor::Sensor, public PollingComponent
+    {
+    public:
+        FerrarisSimulator(uint32_t rpkwh);
+        virtual ~FerrarisSimulator() = default;
+
+        void setup() override;
+        void update() override;
+        void dump_config() override;
+
+        void set_power(float power);
+
+        float get_power() const
+        {
+            return m_power;
+        }
+
+        uint64_t get_rotation_counter() const
+        {
+            return m_rotation_counter;
+        }
+
+        void set_base_power(float power)
+        {
+            m_base_power = power;
+            m_power = power;
+        }
+
+        void set_power_variation(float variation, uint32_t interval)
+        {
+            m_power_variation = variation;
+            m_load_change_interval = interval;
+        }
+
+        void set_levels(float off_level, float on_level)
+        {
+            m_off_level = off_level;
+            m_on_level = on_level;
+        }
+
+        void set_marker_width(float width)
+        {
+            m_marker_width = width;
+        }
+
+        void set_noise(float noise)
+        {
+            m_noise = noise;
+        }
+
+        void set_drift(float drift, uint32_t period)
+        {
+            m_drift = drift;
+            m_drift_period = period;
+        }
+
+        void set_ambient_step(float step, uint32_t interval)
+        {
+            m_ambient_step = step;
+            m_ambient_step_interval = interval;
+        }
+
+        void set_bounce(float probability)
+        {
+            m_bounce_probability = probability;
+        }
+
+        void set_digital(bool digital)
+        {
+            m_digital = digital;
+        }
+
+        void set_rotation_counter_sensor(sensor::Sensor *sensor)
+        {
+            m_rotation_counter_sensor = sensor;
+        }
+
+        void set_energy_meter_sensor(sensor::Sensor *sensor)
+        {
+            m_energy_meter_sensor = sensor;
+        }
+
+        void set_power_consumption_sensor(sensor::Sensor *sensor)
+        {
+            m_power_consumption_sensor = sensor;
+        }
+
+    private:
+        bool is_marker_visible() const;
+        void publish_ground_truth();
+        static float random_gaussian();
+
+    protected:
+        sensor::Sensor* m_rotation_counter_sensor;
+        sensor::Sensor* m_energy_meter_sensor;
+        sensor::Sensor* m_power_consumption_sensor;
+
+        uint32_t m_rotations_per_kwh;
+        float m_base_power;
+        float m_power_variation;
+        uint32_t m_load_change_interval;
+        float m_off_level;
+        float m_on_level;
+        float m_marker_width;
+        float m_noise;
+        float m_drift;
+        uint32_t m_drift_period;
+        float m_ambient_step;
+        uint32_t m_ambient_step_interval;
+        float m_bounce_probability;
+        bool m_digital;
+
+        float m_power;
+        float m_ambient_offset;
+        double m_phase;
+        double m_energy;
+        uint64_t m_rotation_counter;
+        uint32_t m_start_time;
+        int64_t m_last_time;
+    };
+}  // namespace esphome::ferraris
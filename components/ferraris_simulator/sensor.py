@@ -0,0 +1,125 @@
+# Copyright (c) 2024-2025 Jens-Uwe Rossbach
+#
+# This code is licensed under the MIT License.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+
+import esphome.codegen           as cg
+import esphome.config_validation as cv
+
+from esphome.components import sensor
+from esphome.const      import (
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    DEVICE_CLASS_POWER,
+    DEVICE_CLASS_ENERGY,
+    UNIT_WATT,
+    UNIT_WATT_HOURS
+)
+from .                  import FerrarisSimulator
+
+
+CODEOWNERS = ["@jensrossbach"]
+
+CONF_ROTATIONS_PER_KWH     = "rotations_per_kwh"
+CONF_POWER                 = "power"
+CONF_POWER_VARIATION       = "power_variation"
+CONF_LOAD_CHANGE_INTERVAL  = "load_change_interval"
+CONF_OFF_LEVEL             = "off_level"
+CONF_ON_LEVEL              = "on_level"
+CONF_MARKER_WIDTH          = "marker_width"
+CONF_NOISE                 = "noise"
+CONF_DRIFT                 = "drift"
+CONF_DRIFT_PERIOD          = "drift_period"
+CONF_AMBIENT_STEP          = "ambient_step"
+CONF_AMBIENT_STEP_INTERVAL = "ambient_step_interval"
+CONF_BOUNCE                = "bounce"
+CONF_DIGITAL               = "digital"
+CONF_ROTATION_COUNTER      = "rotation_counter"
+CONF_ENERGY_METER          = "energy_meter"
+CONF_POWER_CONSUMPTION     = "power_consumption"
+
+CONFIG_SCHEMA = sensor.sensor_schema(
+        FerrarisSimulator,
+        icon="mdi:sine-wave",
+        state_class=STATE_CLASS_MEASUREMENT,
+        accuracy_decimals=1
+    ).extend({
+        cv.Optional(CONF_ROTATIONS_PER_KWH, default = 75): cv.int_range(min = 1),
+        cv.Optional(CONF_POWER, default = 500): cv.positive_float,
+        cv.Optional(CONF_POWER_VARIATION, default = 0): cv.positive_float,
+        cv.Optional(CONF_LOAD_CHANGE_INTERVAL, default = "60s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_OFF_LEVEL, default = 20): cv.float_,
+        cv.Optional(CONF_ON_LEVEL, default = 80): cv.float_,
+        cv.Optional(CONF_MARKER_WIDTH, default = "5%"): cv.All(cv.percentage, cv.float_range(min = 0.001, max = 0.5)),
+        cv.Optional(CONF_NOISE, default = 0): cv.positive_float,
+        cv.Optional(CONF_DRIFT, default = 0): cv.positive_float,
+        cv.Optional(CONF_DRIFT_PERIOD, default = "1h"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_AMBIENT_STEP, default = 0): cv.positive_float,
+        cv.Optional(CONF_AMBIENT_STEP_INTERVAL, default = "10min"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_BOUNCE, default = "0%"): cv.percentage,
+        cv.Optional(CONF_DIGITAL, default = False): cv.boolean,
+        cv.Optional(CONF_ROTATION_COUNTER): sensor.sensor_schema(
+            icon="mdi:rotate-360",
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            accuracy_decimals=0
+        ),
+        cv.Optional(CONF_ENERGY_METER): sensor.sensor_schema(
+            icon="mdi:transmission-tower",
+            device_class=DEVICE_CLASS_ENERGY,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            unit_of_measurement=UNIT_WATT_HOURS,
+            accuracy_decimals=1
+        ),
+        cv.Optional(CONF_POWER_CONSUMPTION): sensor.sensor_schema(
+            icon="mdi:lightning-bolt",
+            device_class=DEVICE_CLASS_POWER,
+            state_class=STATE_CLASS_MEASUREMENT,
+            unit_of_measurement=UNIT_WATT,
+            accuracy_decimals=1
+        )
+    }).extend(cv.polling_component_schema("20ms"))
+
+
+async def to_code(config):
+    sim = await sensor.new_sensor(config, config[CONF_ROTATIONS_PER_KWH])
+    await cg.register_component(sim, config)
+
+    cg.add(sim.set_base_power(config[CONF_POWER]))
+    cg.add(sim.set_power_variation(config[CONF_POWER_VARIATION], config[CONF_LOAD_CHANGE_INTERVAL]))
+    cg.add(sim.set_levels(config[CONF_OFF_LEVEL], config[CONF_ON_LEVEL]))
+    cg.add(sim.set_marker_width(config[CONF_MARKER_WIDTH]))
+    cg.add(sim.set_noise(config[CONF_NOISE]))
+    cg.add(sim.set_drift(config[CONF_DRIFT], config[CONF_DRIFT_PERIOD]))
+    cg.add(sim.set_ambient_step(config[CONF_AMBIENT_STEP], config[CONF_AMBIENT_STEP_INTERVAL]))
+    cg.add(sim.set_bounce(config[CONF_BOUNCE]))
+    cg.add(sim.set_digital(config[CONF_DIGITAL]))
+
+    if CONF_ROTATION_COUNTER in config:
+        sens = await sensor.new_sensor(config[CONF_ROTATION_COUNTER])
+        cg.add(sim.set_rotation_counter_sensor(sens))
+
+    if CONF_ENERGY_METER in config:
+        sens = await sensor.new_sensor(config[CONF_ENERGY_METER])
+        cg.add(sim.set_energy_meter_sensor(sens))
+
+    if CONF_POWER_CONSUMPTION in config:
+        sens = await sensor.new_sensor(config[CONF_POWER_CONSUMPTION])
+        cg.add(sim.set_power_consumption_sensor(sens))
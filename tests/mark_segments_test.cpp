@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+/*
+ * Host test of the mark segment tracking, build and run from the repository root with:
+ *
+ *   g++ -std=gnu++17 -I tests/stubs -I components/ferraris -o mark_segments_test \
+ *       tests/mark_segments_test.cpp components/ferraris/mark_segments.cpp
+ *   ./mark_segments_test
+ */
+
+
+#include "mark_segments.h"
+
+#include <cstdio>
+#include <vector>
+
+
+using esphome::ferraris::MarkSegments;
+
+namespace
+{
+    static constexpr const uint32_t ROTATION_TIME = 4000;
+
+    /*
+     * Simulates a turntable with unevenly spaced marks at constant speed and
+     * feeds the durations between the detected marks into the tracker.
+     */
+    class TurntableSimulator
+    {
+    public:
+        explicit TurntableSimulator(const std::vector<float> &shares)
+            : m_shares(shares)
+            , m_mark(0)
+            , m_pending(0)
+            , m_rotations(0)
+            , m_completed(0)
+        {
+            m_segments.set_num_marks(static_cast<uint8_t>(m_shares.size()));
+        }
+
+        // passes the given number of marks, all of them being detected
+        void pass(uint32_t num_marks)
+        {
+            for (uint32_t i = 0; i < num_marks; ++i)
+            {
+                advance();
+                detect(m_pending);
+            }
+        }
+
+        // passes the next mark without detecting it
+        void miss()
+        {
+            advance();
+        }
+
+        // detects a spurious mark in the middle of the current segment
+        void spurious()
+        {
+            uint32_t half = static_cast<uint32_t>(m_shares[m_mark] * ROTATION_TIME / 2);
+
+            detect(half);
+            m_pending = -static_cast<int32_t>(half);
+        }
+
+        void reset()
+        {
+            m_segments.reset();
+        }
+
+        MarkSegments &segments()
+        {
+            return m_segments;
+        }
+
+        uint32_t get_rotations() const
+        {
+            return m_rotations;
+        }
+
+        uint32_t get_completed() const
+        {
+            return m_completed;
+        }
+
+        uint8_t get_mark() const
+        {
+            return m_mark;
+        }
+
+    private:
+        void advance()
+        {
+            m_pending += static_cast<int32_t>(m_shares[m_mark] * ROTATION_TIME);
+            m_mark = (m_mark + 1) % m_shares.size();
+
+            if (m_mark == 0)
+            {
+                ++m_rotations;
+            }
+        }
+
+        void detect(int32_t duration)
+        {
+            if (m_segments.add_segment(static_cast<uint32_t>(duration)))
+            {
+                ++m_completed;
+            }
+
+            m_pending = 0;
+        }
+
+        std::vector<float> m_shares;
+        MarkSegments m_segments;
+        uint8_t m_mark;
+        int32_t m_pending;
+        uint32_t m_rotations;
+        uint32_t m_completed;
+    };
+
+    int num_failures = 0;
+
+    void check(bool condition, const char *name, const char *what)
+    {
+        if (!condition)
+        {
+            std::printf("FAILED: %s: %s\n", name, what);
+            ++num_failures;
+        }
+    }
+
+    // checks that counted rotations and numbering match the turntable once it is at the boundary again
+    void check_aligned(TurntableSimulator &sim, const char *name)
+    {
+        check(sim.get_mark() == 0, name, "simulation not at rotation boundary");
+        check(sim.get_completed() == sim.get_rotations(), name, "rotation count differs");
+        check(sim.segments().get_index() == 0, name, "segment numbering differs");
+    }
+
+    void test_missed(const std::vector<float> &shares, uint32_t num_missed, const char *name)
+    {
+        uint32_t num_marks = shares.size();
+        TurntableSimulator sim(shares);
+
+        sim.pass(10 * num_marks + 1);
+        for (uint32_t i = 0; i < num_missed; ++i)
+        {
+            sim.miss();
+        }
+        sim.pass(10 * num_marks - num_missed - 1);
+
+        check_aligned(sim, name);
+    }
+
+    void test_spurious(const std::vector<float> &shares, uint32_t num_spurious, const char *name)
+    {
+        uint32_t num_marks = shares.size();
+        TurntableSimulator sim(shares);
+
+        sim.pass(10 * num_marks + 1);
+        for (uint32_t i = 0; i < num_spurious; ++i)
+        {
+            sim.spurious();
+            sim.pass(1);
+        }
+        sim.pass(10 * num_marks - num_spurious - 1);
+
+        check_aligned(sim, name);
+    }
+
+    void test_reset(const std::vector<float> &shares, const char *name)
+    {
+        uint32_t num_marks = shares.size();
+        TurntableSimulator sim(shares);
+
+        sim.pass(10 * num_marks + 1);
+        uint32_t completed = sim.get_completed();
+
+        // after the reset, the rotation boundary is the next mark and stays there without any correction
+        sim.reset();
+        sim.pass(10 * num_marks);
+
+        check(sim.get_completed() - completed == 10, name, "rotation count differs after reset");
+        check(sim.segments().get_index() == 0, name, "segment numbering shifted after reset");
+    }
+
+    void test_ambiguous(const char *name)
+    {
+        // symmetric spacing can't tell a shift by one from a shift by three
+        TurntableSimulator sim({0.2f, 0.3f, 0.2f, 0.3f});
+
+        sim.pass(41);
+        sim.miss();
+        sim.pass(38);
+
+        // only the detected marks are counted
+        check(sim.get_completed() == (41 + 38) / 4, name, "rotation count adjusted");
+        check(sim.segments().get_index() == (41 + 38) % 4, name, "segment numbering adjusted");
+    }
+}  // namespace
+
+int main()
+{
+    const std::vector<float> two_marks = {0.3f, 0.7f};
+    const std::vector<float> four_marks = {0.1f, 0.3f, 0.25f, 0.35f};
+
+    test_missed(two_marks, 1, "2 marks, 1 missed");
+    test_spurious(two_marks, 1, "2 marks, 1 spurious");
+    test_missed(four_marks, 1, "4 marks, 1 missed");
+    test_missed(four_marks, 2, "4 marks, 2 missed");
+    test_spurious(four_marks, 1, "4 marks, 1 spurious");
+    test_spurious(four_marks, 2, "4 marks, 2 spurious");
+    test_reset(two_marks, "2 marks, reset");
+    test_reset(four_marks, "4 marks, reset");
+    test_ambiguous("4 marks, ambiguous");
+
+    if (num_failures == 0)
+    {
+        std::printf("All tests passed\n");
+    }
+
+    return (num_failures == 0) ? 0 : 1;
+}
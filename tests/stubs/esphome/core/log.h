@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2024-2025 Jens-Uwe Rossbach
+ *
+ * This code is licensed under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#pragma once
+
+#include <cstdio>
+
+
+// minimal replacement of the ESPHome logger for building the tests on the host
+
+#define ESP_LOGE(tag, ...) (std::printf("[E][%s] ", tag), std::printf(__VA_ARGS__), std::printf("\n"))
+#define ESP_LOGW(tag, ...) (std::printf("[W][%s] ", tag), std::printf(__VA_ARGS__), std::printf("\n"))
+#define ESP_LOGI(tag, ...) (std::printf("[I][%s] ", tag), std::printf(__VA_ARGS__), std::printf("\n"))
+#define ESP_LOGD(tag, ...) (std::printf("[D][%s] ", tag), std::printf(__VA_ARGS__), std::printf("\n"))
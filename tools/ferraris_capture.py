@@ -0,0 +1,259 @@
+#!/usr/bin/env python3
+# Copyright (c) 2024-2025 Jens-Uwe Rossbach
+#
+# This code is licensed under the MIT License.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+
+"""
+Host-side reader for sample captures of the Ferraris component.
+
+The capture is extracted from a log (e.g. the output of "esphome logs")
+containing the lines written by the action "ferraris.dump_sample_capture".
+It can be summarized, converted to CSV, saved as binary file or replayed
+with different settings to evaluate threshold, tolerances and debouncing.
+"""
+
+import argparse
+import base64
+import re
+import struct
+import sys
+
+
+MAGIC          = b"FRCP"
+FORMAT_VERSION = 2
+HEADER_FORMAT  = "<4sB3xIIfffIII"
+RECORD_FORMAT  = "<HBxf"
+HEADER_SIZE    = struct.calcsize(HEADER_FORMAT)
+RECORD_SIZE    = struct.calcsize(RECORD_FORMAT)
+
+FLAG_STATE       = 0x01
+FLAG_ROTATION    = 0x02
+FLAG_DEBOUNCED   = 0x04
+FLAG_CALIBRATION = 0x08
+
+LINE_PATTERN = re.compile(r"FRCP (BEGIN (\d+)|END|(\d+) ([A-Za-z0-9+/=]+))")
+
+
+class Capture:
+    def __init__(self, data):
+        if len(data) < HEADER_SIZE:
+            raise ValueError("Capture is too short")
+
+        (magic, version, count, start_time, threshold, off_tolerance, on_tolerance,
+         debounce_threshold, rotations_per_kwh, marks_per_rotation) = struct.unpack_from(HEADER_FORMAT, data)
+
+        if magic != MAGIC:
+            raise ValueError("Invalid magic")
+        if version != FORMAT_VERSION:
+            raise ValueError(f"Unsupported format version {version}")
+        if len(data) < HEADER_SIZE + count * RECORD_SIZE:
+            raise ValueError("Capture is incomplete")
+
+        self.data = data[:HEADER_SIZE + count * RECORD_SIZE]
+        self.start_time = start_time
+        self.threshold = threshold
+        self.off_tolerance = off_tolerance
+        self.on_tolerance = on_tolerance
+        self.debounce_threshold = debounce_threshold
+        self.rotations_per_kwh = rotations_per_kwh
+        self.marks_per_rotation = max(marks_per_rotation, 1)
+
+        # records as tuples of (absolute time in ms, value, flags)
+        self.records = []
+        time = start_time
+        for index in range(count):
+            delta_time, flags, value = struct.unpack_from(RECORD_FORMAT, data, HEADER_SIZE + index * RECORD_SIZE)
+            # the time difference of the first record refers to an already overwritten record
+            if index > 0:
+                time += delta_time
+            self.records.append((time, value, flags))
+
+
+def extract(lines):
+    """Returns the serialized data of the last complete capture found in the log lines."""
+    result = None
+    chunks = None
+    size = 0
+
+    for line in lines:
+        match = LINE_PATTERN.search(line)
+        if match is None:
+            continue
+
+        if match.group(2) is not None:
+            chunks = {}
+            size = int(match.group(2))
+        elif match.group(1) == "END":
+            if chunks is not None:
+                data = b"".join(chunks[offset] for offset in sorted(chunks))
+                if len(data) != size:
+                    print(f"Warning: incomplete capture ({len(data)} of {size} bytes)", file=sys.stderr)
+                else:
+                    result = data
+            chunks = None
+        elif chunks is not None:
+            chunks[int(match.group(3))] = base64.b64decode(match.group(4))
+
+    if result is None:
+        raise ValueError("No complete capture found")
+
+    return result
+
+
+def replay(capture, threshold, off_tolerance, on_tolerance, debounce_threshold):
+    """Re-evaluates the raw values the same way as the Ferraris component does."""
+    state = False
+    last_time = None
+    last_rising_time = None
+    segment_times = []
+    debounced = 0
+
+    for time, value, flags in capture.records:
+        if flags & FLAG_CALIBRATION:
+            continue
+
+        if state:
+            new_state = value > threshold - off_tolerance
+        else:
+            new_state = value > threshold + on_tolerance
+
+        if new_state != state:
+            if new_state:
+                if last_rising_time is None:
+                    last_rising_time = time
+                elif time - last_time < debounce_threshold:
+                    debounced += 1
+                else:
+                    segment_times.append(time - last_rising_time)
+                    last_rising_time = time
+
+            last_time = time
+            state = new_state
+
+    # every group of consecutive segments between the marks makes up one full rotation
+    num_marks = capture.marks_per_rotation
+    rotation_times = [sum(segment_times[index:index + num_marks])
+                      for index in range(0, len(segment_times) - num_marks + 1, num_marks)]
+
+    return rotation_times, debounced
+
+
+def load(args):
+    if args.input.endswith(".bin"):
+        with open(args.input, "rb") as file:
+            return Capture(file.read())
+
+    with open(args.input, "r", errors="replace") as file:
+        return Capture(extract(file))
+
+
+def print_rotations(capture, rotation_times, debounced):
+    print(f"Rotations:          {len(rotation_times)}")
+    print(f"Debounced edges:    {debounced}")
+    if rotation_times:
+        average = sum(rotation_times) / len(rotation_times)
+        power = 3600000000 / (average * capture.rotations_per_kwh)
+        print(f"Rotation time:      min {min(rotation_times)} ms, avg {average:.0f} ms, max {max(rotation_times)} ms")
+        print(f"Average power:      {power:.1f} W")
+
+
+def command_info(capture, args):
+    records = capture.records
+    print(f"Records:            {len(records)}")
+    if not records:
+        return
+
+    duration = records[-1][0] - records[0][0]
+    values = [value for _, value, _ in records]
+    print(f"Duration:           {duration} ms")
+    if duration > 0:
+        print(f"Sample interval:    {duration / max(len(records) - 1, 1):.2f} ms")
+    print(f"Values:             min {min(values):.2f}, max {max(values):.2f}")
+    print(f"Threshold:          {capture.threshold:.2f} (OFF tolerance {capture.off_tolerance:.2f}, ON tolerance {capture.on_tolerance:.2f})")
+    print(f"Debounce threshold: {capture.debounce_threshold} ms")
+    print(f"Rotations per kWh:  {capture.rotations_per_kwh}")
+    print(f"Marks per rotation: {capture.marks_per_rotation}")
+    print(f"Captured rotations: {sum(1 for _, _, flags in records if flags & FLAG_ROTATION)}")
+    print(f"Captured debounced: {sum(1 for _, _, flags in records if flags & FLAG_DEBOUNCED)}")
+
+
+def command_csv(capture, args):
+    output = open(args.output, "w") if args.output else sys.stdout
+    output.write("time_ms,value,state,rotation,debounced,calibration\n")
+    for time, value, flags in capture.records:
+        output.write(
+            f"{time - capture.start_time},{value:.3f},{int(bool(flags & FLAG_STATE))},"
+            f"{int(bool(flags & FLAG_ROTATION))},{int(bool(flags & FLAG_DEBOUNCED))},"
+            f"{int(bool(flags & FLAG_CALIBRATION))}\n")
+    if output is not sys.stdout:
+        output.close()
+
+
+def command_save(capture, args):
+    with open(args.output, "wb") as file:
+        file.write(capture.data)
+
+
+def command_replay(capture, args):
+    threshold = capture.threshold if args.threshold is None else args.threshold
+    off_tolerance = capture.off_tolerance if args.off_tolerance is None else args.off_tolerance
+    on_tolerance = capture.on_tolerance if args.on_tolerance is None else args.on_tolerance
+    debounce_threshold = capture.debounce_threshold if args.debounce_threshold is None else args.debounce_threshold
+
+    print(f"Threshold:          {threshold:.2f} (OFF tolerance {off_tolerance:.2f}, ON tolerance {on_tolerance:.2f})")
+    print(f"Debounce threshold: {debounce_threshold} ms")
+    print_rotations(capture, *replay(capture, threshold, off_tolerance, on_tolerance, debounce_threshold))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Reads sample captures of the Ferraris component.")
+    parser.add_argument("input", help="log file containing the dumped capture or binary capture file (*.bin)")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    commands.add_parser("info", help="print a summary of the capture")
+
+    csv_parser = commands.add_parser("csv", help="convert the capture to CSV")
+    csv_parser.add_argument("-o", "--output", help="output file (default: stdout)")
+
+    save_parser = commands.add_parser("save", help="save the capture as binary file")
+    save_parser.add_argument("output", help="output file")
+
+    replay_parser = commands.add_parser("replay", help="replay the capture with different settings")
+    replay_parser.add_argument("--threshold", type=float)
+    replay_parser.add_argument("--off-tolerance", type=float)
+    replay_parser.add_argument("--on-tolerance", type=float)
+    replay_parser.add_argument("--debounce-threshold", type=int)
+
+    args = parser.parse_args()
+
+    try:
+        capture = load(args)
+    except (OSError, ValueError) as error:
+        print(f"Error: {error}", file=sys.stderr)
+        return 1
+
+    {"info": command_info, "csv": command_csv, "save": command_save, "replay": command_replay}[args.command](capture, args)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())